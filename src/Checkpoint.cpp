@@ -0,0 +1,98 @@
+/**
+ * @file Checkpoint.cpp
+ * @author Jaya García
+ * @brief Implementation of the Checkpoint struct
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "Checkpoint.hh"
+# include "MappedFile.hh"
+# include <cstring>
+# include <fstream>
+# include <unistd.h>
+
+// Sections start at multiples of 8 bytes, as in the graph snapshots
+static size_t aligned(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+template <class T>
+static bool read_section(const char*& p, const char* end, vector<T>& values, size_t n) {
+    if (size_t(end - p) < aligned(n*sizeof(T))) return false;
+    values.resize(n);
+    if (n > 0) memcpy(values.data(), p, n*sizeof(T));
+    p += aligned(n*sizeof(T));
+    return true;
+}
+
+template <class T>
+static void write_section(ofstream& file, const T* values, size_t n) {
+    const char padding[8] = {};
+    size_t bytes = n*sizeof(T);
+    file.write(reinterpret_cast<const char*>(values), bytes);
+    file.write(padding, aligned(bytes) - bytes);
+}
+
+Checkpoint::Checkpoint() {
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+}
+
+bool Checkpoint::read(const string& path) {
+    MappedFile file(path);
+    if (file.size() < sizeof(CheckpointHeader)) return false;
+    CheckpointHeader h;
+    memcpy(&h, file.data(), sizeof(h));
+    if (memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 or h.version != CHECKPOINT_VERSION) return false;
+
+    const char* p = file.data() + aligned(sizeof(CheckpointHeader));
+    const char* end = file.data() + file.size();
+    vector<char> state;
+    bool complete = read_section(p, end, nodes_type, h.N)
+                and read_section(p, end, strategy, h.N)
+                and read_section(p, end, threshold, h.N)
+                and read_section(p, end, queued, h.N)
+                and read_section(p, end, current, h.num_current)
+                and read_section(p, end, next, h.num_next)
+                and read_section(p, end, visited_states, h.num_visited)
+                and read_section(p, end, visited_steps, h.num_visited)
+                and read_section(p, end, state, h.generator_size);
+    if (not complete or p != end) return false;
+    generator.assign(state.begin(), state.end());
+    header = h;
+    return true;
+}
+
+bool Checkpoint::write(const string& path) const {
+    CheckpointHeader h = header;
+    h.N = strategy.size();
+    h.num_current = current.size();
+    h.num_next = next.size();
+    h.num_visited = visited_states.size();
+    h.generator_size = generator.size();
+
+    string tmp = path + "." + to_string(getpid());
+    ofstream file(tmp, ios::binary);
+    if (not file) return false;
+    write_section(file, &h, 1);
+    write_section(file, nodes_type.data(), nodes_type.size());
+    write_section(file, strategy.data(), strategy.size());
+    write_section(file, threshold.data(), threshold.size());
+    // The queue has a flag per player, padded to a flag per node
+    vector<char> flags(queued);
+    flags.resize(h.N, false);
+    write_section(file, flags.data(), flags.size());
+    write_section(file, current.data(), current.size());
+    write_section(file, next.data(), next.size());
+    write_section(file, visited_states.data(), visited_states.size());
+    write_section(file, visited_steps.data(), visited_steps.size());
+    write_section(file, generator.data(), generator.size());
+    file.close();
+    if (file.fail() or rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
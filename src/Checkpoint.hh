@@ -0,0 +1,114 @@
+/**
+ * @file Checkpoint.hh
+ * @author Jaya García
+ * @brief Header of the Checkpoint struct
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef CHECKPOINT_HH
+# define CHECKPOINT_HH
+
+# include <string>
+# include <vector>
+# include <cstdint>
+
+using namespace std;
+
+using uint = unsigned int;
+
+const char CHECKPOINT_MAGIC[8] = {'T', 'I', 'M', 'G', 'C', 'K', 'P', 'T'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+/** @struct CheckpointHeader
+ * @brief Fixed part of a checkpoint file, followed by its sections
+ *
+ */
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+
+    /** @brief Game that wrote the checkpoint: 0 for the seed game, 1 and
+     * 2 for the threshold game with cooperative and malicious agents */
+    uint32_t kind;
+    uint32_t dynamics, conflict_rule;
+    uint64_t N, seed;
+
+    /** @brief Zobrist hash of the strategies, checked when read */
+    uint64_t profile_hash;
+
+    /** @brief Rounds started, and last round where an agent moved */
+    uint32_t round, last_round;
+
+    /** @brief Moves recorded by the cycle detection */
+    uint32_t num_moves;
+
+    /** @brief State of the PlayerQueue of the sequential dynamics */
+    uint32_t num_queued;
+    int32_t cursor;
+    uint32_t sweeps;
+
+    /** @brief Seconds the dynamics ran before the checkpoint */
+    double elapsed;
+
+    uint64_t num_current, num_next, num_visited, generator_size;
+};
+
+/** @struct Checkpoint
+ * @brief State of game_dynamics between two moves, from which it can go
+ * on as if it had never stopped
+ *
+ * Besides the profile and the thresholds, it keeps what the dynamics
+ * would otherwise rebuild differently: the players queued in the
+ * sequential dynamics, the states visited for the cycle detection, the
+ * time spent and the random number generator. Files are written aside
+ * and renamed, so a run killed while writing leaves the previous one.
+ *
+ */
+struct Checkpoint {
+
+    CheckpointHeader header = CheckpointHeader();
+
+    /** @brief Type of every node, to check it is the same game */
+    vector<uint8_t> nodes_type;
+
+    /** @brief Strategy of every node, -1 if it has none */
+    vector<int> strategy;
+
+    /** @brief Threshold of every node */
+    vector<double> threshold;
+
+    /** @brief PlayerQueue contents */
+    vector<char> queued;
+    vector<int> current, next;
+
+    /** @brief States visited by the dynamics and the step of each */
+    vector<uint64_t> visited_states;
+    vector<uint32_t> visited_steps;
+
+    /** @brief Text state of the random number generator */
+    string generator;
+
+    Checkpoint();
+
+    /**
+     * @brief Reads a checkpoint
+     *
+     * @param path file
+     * @return false if there is no valid checkpoint in the file
+     */
+    bool read(const string& path);
+
+    /**
+     * @brief Writes the checkpoint, replacing the file at once
+     *
+     * @param path file
+     * @return false if it could not be written
+     */
+    bool write(const string& path) const;
+};
+
+# endif
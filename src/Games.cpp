@@ -3,7 +3,9 @@
 # include <algorithm>
 # include <random>
 # include <list>
-# include <omp.h>
+# include <atomic>
+# include <sys/stat.h>
+# include "ThreadPool.hh"
 # include "InitialSetSelection.hh"
 # include "ThresholdSelection.hh"
 # include "Process_Data.hh"
@@ -18,103 +20,222 @@ const string FIRST_MODEL_CONF = "complete";         // random/complete/empty
 const string SECOND_MODEL_CONF = "empty";           // random/complete/empty
 const bool thresholds_malicious = true;            // cooperative or malicious
 const uint NUM_REPS = 5;
+const Dynamics DYNAMICS = SEQUENTIAL;               // sequential/jacobi best responses
+const ConflictRule CONFLICT_RULE = SPECULATIVE;     // commit rule of the jacobi rounds
+const uint MAX_ROUNDS = 0;                          // rounds per game, 0 for no limit
+const double MAX_SECONDS = 0;                       // wall time per game, 0 for no limit
+const double CHECKPOINT_SECONDS = 600;              // wall time between checkpoints of a game
+const bool RESUME = false;                          // go on from the checkpoints of a killed run
 const uint seed = 2000;
 
 const string outpath = "../data/results/";
-const string result_header = "Network,N,InitialProp,InfluenceProp,InfluenceTargetProp,MinDegreeIni,MaxDegreeIni,AvgDegreeIni,MinPageIni,MaxPageIni,AvgPageIni,MinBtwIni,MaxBtwIni,AvgBtwIni,MinDegreeInf,MaxDegreeInf,AvgDegreeInf,MinPageInf,MaxPageInf,AvgPageInf,MinBtwInf,MaxBtwInf,AvgBtwInf";
+const string checkpath = "../data/checkpoints/";
 
+// Sets and thresholds of a game once its dynamics end
+struct GameOutcome {
+    NodeSet initial_set, target_set, final_influence;
+    Thresholds thresholds;
+    DynamicsOutcome dynamics;
+};
+
+GameOutcome outcome_of(const InfluenceMaximization& game, const DynamicsOutcome& dynamics) {
+    return GameOutcome{game.initial_set, game.target_set, game.final_influence, game.thresholds, dynamics};
+}
+
+// Rules of the dynamics, the same for every game, and the stream of the
+// random subsets of its job. With RESUME, a game killed before its
+// dynamics end goes on from its checkpoint when run again with the same
+// rules and seed
+void set_rules(InfluenceMaximization& game, string name, const Philox& subsets) {
+    game.generator = subsets;
+    game.dynamics = DYNAMICS;
+    game.conflict_rule = CONFLICT_RULE;
+    game.max_rounds = MAX_ROUNDS;
+    game.max_seconds = MAX_SECONDS;
+    game.checkpoint_path = checkpath + name + ".bin";
+    game.checkpoint_seconds = CHECKPOINT_SECONDS;
+    game.resume = RESUME;
+}
+
+// A replicate of the games on a dataset, the unit of work of the experiments
+struct Job {
+    uint dataset, threshold, replicate;
+};
+
+// Loads every dataset once, as tasks of the pool
+vector<Graph> load_graphs(const vector<Data>& datasets, double th) {
+    vector<Graph> graphs(datasets.size());
+    ThreadPool::instance().parallel_for(datasets.size(), [&](uint d) {
+        Process_Data PD;
+        PD.read_graph(graphs[d], datasets[d], th);
+    });
+    return graphs;
+}
+
+// Runs every job as a task of the pool. Whichever thread runs a task, it
+// takes the next job by decreasing size of its graph, so the largest
+// graphs start first and do not leave the other threads idle at the end.
+// A thread inside a job only waits for the tasks of that job, so it never
+// starts another job before its own ends and the jobs start in that order
+template <class F>
+void run_jobs(const vector<Job>& jobs, const vector<Graph>& graphs, const F& run) {
+    VI order(jobs.size());
+    for (uint j = 0; j < jobs.size(); ++j) order[j] = j;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return graphs[jobs[a].dataset].adjacency.target.size() > graphs[jobs[b].dataset].adjacency.target.size();
+    });
+    atomic<uint> next{0};
+    ThreadPool::instance().parallel_for(jobs.size(), [&](uint) { run(order[next++]); });
+}
+
+// Every (threshold, dataset, replicate) is a job. Every game changes its
+// own copy of the thresholds, and every replicate draws from its own
+// streams, so a job gives the same result on any thread and in any order.
+// The results are written once all the jobs end, in the order of the
+// thresholds and the datasets
 void first_experiment(const list<Data>& datasets) {
     cout << "----- FIRST EXPERIMENT -----" << endl;
     Process_Data PD;
     VD ths = {0.25, 0.5, 0.75, 0.95};
-    std::mt19937 generator = std::mt19937(seed);
-    # pragma omp parallel for
-    for (auto& th: ths) {
-        string path = outpath + "first-experiment/" + FIRST_MODEL_CONF + "/th-" + to_string(th).substr(0,4) + "/";
-        PD.create_file(path + "model-1.txt");
-        PD.create_file(path + "model-2.txt");
+    vector<Data> data(datasets.begin(), datasets.end());
+    uint D = data.size();
+
+    // The thresholds of the games are assigned from th, so a single
+    // graph per dataset serves every threshold
+    vector<Graph> graphs = load_graphs(data, 0.5);
+    vector<string> filenames(D);
+    for (uint d = 0; d < D; ++d) {
+        filenames[d] = PD.get_name_data_set(data[d]);
+        cout << "Working on " << filenames[d] << "..."<< endl;
+    }
+
+    vector<Job> jobs;
+    for (uint t = 0; t < ths.size(); ++t)
+        for (uint d = 0; d < D; ++d)
+            for (uint i = 0; i < NUM_REPS; ++i)
+                jobs.push_back(Job{d, t, i});
 
-        string filename;
-        cout << " -> Fixed Threshold " << th << endl;
-        for(auto ds: datasets) {
-            Graph G;
-            PD.read_graph(G, ds, th);
-            filename = PD.get_name_data_set(ds);
-            cout << "Working on " << filename << "..."<< endl;
+    vector<GameOutcome> first_model(jobs.size()), second_model(jobs.size());
+    run_jobs(jobs, graphs, [&](uint j) {
+        const Job& job = jobs[j];
+        const Graph& G = graphs[job.dataset];
+        double th = ths[job.threshold];
+        Philox targets(seed, data[job.dataset], job.threshold, job.replicate, PICK_TARGETS);
+        Philox configuration(seed, data[job.dataset], job.threshold, job.replicate, PICK_CONFIGURATION);
+        Philox subsets(seed, data[job.dataset], job.threshold, job.replicate, PICK_SUBSETS);
+        string game = "first-" + FIRST_MODEL_CONF + "-th-" + to_string(th).substr(0,4) + "-" + filenames[job.dataset] + "-" + to_string(job.replicate);
 
+        // Re initialize thresholds
+        Thresholds base = G.threshold;
+        G.assign_thresholds(base, th);
+
+        // First model
+        InitialSetSelection IS(G, base);
+        set_rules(IS, game + "-model-1", subsets);
+        IS.select_target_set(PROPORTION_TARGET, targets);
+        IS.select_initial_configuration(FIRST_MODEL_CONF, configuration);
+        first_model[j] = outcome_of(IS, IS.game_dynamics());
+
+        // Second model
+        ThresholdSelection TS(G, base, false);
+        set_rules(TS, game + "-model-2", subsets);
+        TS.select_initial_set(IS.initial_set);
+        TS.select_target_set(IS.target_set);
+        TS.select_initial_configuration(SECOND_MODEL_CONF);
+        second_model[j] = outcome_of(TS, TS.game_dynamics());
+    });
+
+    for (uint t = 0; t < ths.size(); ++t) {
+        string path = outpath + "first-experiment/" + FIRST_MODEL_CONF + "/th-" + to_string(ths[t]).substr(0,4) + "/";
+        PD.create_file(path + "model-1.txt");
+        PD.create_file(path + "model-2.txt");
+        for (uint d = 0; d < D; ++d) {
+            const Graph& G = graphs[d];
             Statistics initial_state;
             Statistics final_state(G.N);
             for (uint i = 0; i < NUM_REPS; ++i) {
-                // Re initialize thresholds
-                G.assign_thresholds(th);
-
-                // First model
-                InitialSetSelection IS(G);
-                IS.select_target_set(PROPORTION_TARGET, generator);
-                IS.select_initial_configuration(FIRST_MODEL_CONF, generator);
-                uint rounds = IS.game_dynamics();
-                initial_state.update_metrics(G, IS.initial_set, IS.target_set, IS.final_influence, rounds);
-                
-                // Second model
-                ThresholdSelection TS(G);
-                TS.select_initial_set(IS.initial_set);
-                TS.select_target_set(IS.target_set);
-                TS.select_initial_configuration(SECOND_MODEL_CONF);
-                rounds = TS.game_dynamics();
-            
-                final_state.update_metrics(G, TS.initial_set, TS.target_set, TS.final_influence, rounds);
+                uint j = (t*D + d)*NUM_REPS + i;
+                GameOutcome& m1 = first_model[j];
+                GameOutcome& m2 = second_model[j];
+                initial_state.update_metrics(G, m1.thresholds, m1.initial_set, m1.target_set, m1.final_influence, m1.dynamics);
+                final_state.update_metrics(G, m2.thresholds, m2.initial_set, m2.target_set, m2.final_influence, m2.dynamics);
             }
             initial_state.average_statistics(NUM_REPS);
             final_state.average_statistics(NUM_REPS);
-            PD.write_statistics(path + "model-1.txt", G, initial_state, filename);
-            PD.write_statistics(path + "model-2.txt", G, final_state, filename);
-            PD.write_thresholds(path + "thresholds/" + PD.get_name_data_set(ds) + ".txt", final_state);
+            PD.write_statistics(path + "model-1.txt", G, initial_state, filenames[d]);
+            PD.write_statistics(path + "model-2.txt", G, final_state, filenames[d]);
+            PD.write_thresholds(path + "thresholds/" + filenames[d] + ".txt", final_state);
         }
-        cout << "Done!"<< endl;
     }
+    cout << "Done!"<< endl;
 }
 
+// Every (dataset, replicate) is a job, scheduled as in the first experiment
 void second_experiment(const list<Data>& datasets) {
     cout << "----- SECOND EXPERIMENT -----" << endl;
     Process_Data PD;
     string path = outpath + "second-experiment/";
-    std::mt19937 generator = std::mt19937(seed);
     if (not thresholds_malicious)
         path += "cooperative/";
     else
         path += "malicious/";
-    
+
+    vector<Data> data(datasets.begin(), datasets.end());
+    uint D = data.size();
+    vector<Graph> graphs = load_graphs(data, 0.5);
+    vector<string> filenames(D);
+    for (uint d = 0; d < D; ++d) {
+        filenames[d] = PD.get_name_data_set(data[d]);
+        cout << "Working on " << filenames[d] << "..."<< endl;
+    }
+
+    vector<Job> jobs;
+    for (uint d = 0; d < D; ++d)
+        for (uint i = 0; i < NUM_REPS; ++i)
+            jobs.push_back(Job{d, 0, i});
+
+    vector<GameOutcome> second_model(jobs.size()), first_model(jobs.size());
+    run_jobs(jobs, graphs, [&](uint j) {
+        const Job& job = jobs[j];
+        const Graph& G = graphs[job.dataset];
+        Philox initial(seed, data[job.dataset], 0, job.replicate, PICK_INITIAL);
+        Philox targets(seed, data[job.dataset], 0, job.replicate, PICK_TARGETS);
+        Philox subsets(seed, data[job.dataset], 0, job.replicate, PICK_SUBSETS);
+        string game = string("second-") + (thresholds_malicious ? "malicious-" : "cooperative-") + filenames[job.dataset] + "-" + to_string(job.replicate);
+
+        ThresholdSelection TS(G, thresholds_malicious);
+        set_rules(TS, game + "-model-2", subsets);
+
+        TS.select_initial_set(PROPORTION_INITIAL, initial);
+        TS.select_target_set(PROPORTION_TARGET, targets);
+        TS.select_initial_configuration(SECOND_MODEL_CONF);
+        second_model[j] = outcome_of(TS, TS.game_dynamics());
+
+        // The seeds play against the thresholds chosen by the agents
+        InitialSetSelection IS(G, TS.thresholds);
+        set_rules(IS, game + "-model-1", subsets);
+        IS.select_target_set(TS.target_set);
+        IS.select_initial_configuration(TS.initial_set);
+        first_model[j] = outcome_of(IS, IS.game_dynamics());
+    });
+
     PD.create_file(path + "model-1.txt");
     PD.create_file(path + "model-2.txt");
-    for (auto ds: datasets) {
-        Graph G;
-        PD.read_graph(G, ds, 0.5);
-        string filename = PD.get_name_data_set(ds);
-        cout << "Working on " << filename << "..."<< endl;
-        
+    for (uint d = 0; d < D; ++d) {
+        const Graph& G = graphs[d];
         Statistics original_state;
         Statistics final_state(G.N);
         for (uint i = 0; i < NUM_REPS; ++i) {
-
-            ThresholdSelection TS(G, thresholds_malicious);
-            
-            TS.select_initial_set(PROPORTION_INITIAL, generator);
-            TS.select_target_set(PROPORTION_TARGET, generator);
-            TS.select_initial_configuration(SECOND_MODEL_CONF);
-            uint rounds = TS.game_dynamics();
-            original_state.update_metrics(G, TS.initial_set, TS.target_set, TS.final_influence, rounds);
-
-            InitialSetSelection IS(G);
-            IS.select_target_set(TS.target_set);
-            IS.select_initial_configuration(TS.initial_set);
-            rounds = IS.game_dynamics();
-            final_state.update_metrics(G, IS.initial_set, IS.target_set, IS.final_influence, rounds);
+            GameOutcome& m2 = second_model[d*NUM_REPS + i];
+            GameOutcome& m1 = first_model[d*NUM_REPS + i];
+            original_state.update_metrics(G, m2.thresholds, m2.initial_set, m2.target_set, m2.final_influence, m2.dynamics);
+            final_state.update_metrics(G, m1.thresholds, m1.initial_set, m1.target_set, m1.final_influence, m1.dynamics);
         }
         original_state.average_statistics(NUM_REPS);
         final_state.average_statistics(NUM_REPS);
-        PD.write_statistics(path + "model-2.txt", G, original_state, filename);
-        PD.write_statistics(path + "model-1.txt", G, final_state, filename);
-        PD.write_thresholds(path + "thresholds/" + PD.get_name_data_set(ds) + ".txt", final_state);
+        PD.write_statistics(path + "model-2.txt", G, original_state, filenames[d]);
+        PD.write_statistics(path + "model-1.txt", G, final_state, filenames[d]);
+        PD.write_thresholds(path + "thresholds/" + filenames[d] + ".txt", final_state);
     }
     cout << "Done" << endl;
 }
@@ -122,6 +243,7 @@ void second_experiment(const list<Data>& datasets) {
 int main() {
     // Set of datasets
     list<Data> datasets({DINING_TABLE, DOLPHINS, HUMAN_BRAIN, ARXIV, WIKIPEDIA, CAIDA});//, ENRON, GNUTELLA, EPINIONS, HIGGS});
+    mkdir(checkpath.c_str(), 0755);
     // Run both experiments
     // first_experiment(datasets);
     // second_experiment(datasets);
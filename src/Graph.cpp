@@ -1,114 +1,251 @@
 #include "Graph.hh"
 #include <iostream>
-#include <random>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+#include <climits>
+#include <charconv>
 # include <omp.h>
 
 Graph::Graph() = default;
 
-Graph::Graph(const VE &Edges, const VD& pg, const VD& bw, bool directed, double th) {
-    E = static_cast<int>(Edges.size());
-    this->directed = directed;
-    adjacency = VVPID();
-    mapping = VI();
-    threshold = VD();
-    if (directed) predecessors = VVPID();
-
-    int last_node = 0;
-    UMII MP;
-
-
-    for (edge e : Edges) {
-        if (MP.find(e.v) == MP.end()) {
-            mapping.push_back(e.v);
-            MP[e.v] = last_node++;
-            adjacency.push_back(VPID());
-            if (directed) predecessors.push_back(VPID());
-            threshold.push_back(0);
-        }
-        if (MP.find(e.u) == MP.end())
+// Stable parallel LSD radix sort of 64 bit keys, one byte per pass
+static void radix_sort(vector<uint64_t>& keys) {
+    uint64_t max_key = 0;
+    # pragma omp parallel for reduction(max: max_key)
+    for (size_t i = 0; i < keys.size(); ++i) max_key = max(max_key, keys[i]);
+
+    const int RADIX = 8;
+    const int BUCKETS = 1 << RADIX;
+    vector<uint64_t> buffer(keys.size());
+    vector<size_t> histogram;
+    for (int shift = 0; shift < 64 and (max_key >> shift) > 0; shift += RADIX) {
+        # pragma omp parallel
         {
-            mapping.push_back(e.u);
-            MP[e.u] = last_node++;
-            adjacency.push_back(VPID());
-            if (directed) predecessors.push_back(VPID());
-            threshold.push_back(0);
+            int t = omp_get_thread_num();
+            int num_threads = omp_get_num_threads();
+            # pragma omp single
+            histogram.assign(size_t(num_threads)*BUCKETS, 0);
+
+            size_t lo = keys.size()*t/num_threads;
+            size_t hi = keys.size()*(t + 1)/num_threads;
+            size_t* local = &histogram[size_t(t)*BUCKETS];
+            for (size_t i = lo; i < hi; ++i) ++local[(keys[i] >> shift) & (BUCKETS - 1)];
+            # pragma omp barrier
+
+            // Every thread writes its chunk after the same digit of the previous ones
+            # pragma omp single
+            {
+                size_t offset = 0;
+                for (int d = 0; d < BUCKETS; ++d)
+                    for (int p = 0; p < num_threads; ++p) {
+                        size_t c = histogram[size_t(p)*BUCKETS + d];
+                        histogram[size_t(p)*BUCKETS + d] = offset;
+                        offset += c;
+                    }
+            }
+            for (size_t i = lo; i < hi; ++i) buffer[local[(keys[i] >> shift) & (BUCKETS - 1)]++] = keys[i];
+        }
+        keys.swap(buffer);
+    }
+}
+
+// Replaces every value by the sum of the previous ones and returns the total
+static uint exclusive_scan(VI& values) {
+    vector<size_t> partial;
+    # pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int num_threads = omp_get_num_threads();
+        # pragma omp single
+        partial.assign(num_threads + 1, 0);
+
+        size_t lo = values.size()*t/num_threads;
+        size_t hi = values.size()*(t + 1)/num_threads;
+        size_t sum = 0;
+        for (size_t i = lo; i < hi; ++i) sum += values[i];
+        partial[t + 1] = sum;
+        # pragma omp barrier
+        # pragma omp single
+        for (int p = 0; p < num_threads; ++p) partial[p + 1] += partial[p];
+
+        sum = partial[t];
+        for (size_t i = lo; i < hi; ++i) {
+            size_t value = values[i];
+            values[i] = sum;
+            sum += value;
         }
-        int v = MP[e.v];
-        int u = MP[e.u];
+    }
+    return partial.back();
+}
+
+// Builds the CSR of a list of arcs, keeping the arcs of every node in the
+// order of the list
+static CSR build_csr(uint N, const VI& source, const VI& dest, const VD& weight) {
+    size_t A = source.size();
+    CSR C;
+    C.offset = VI(N + 1, 0);
+    vector<uint64_t> keys(A);
+    # pragma omp parallel for
+    for (size_t a = 0; a < A; ++a) {
+        keys[a] = (uint64_t(source[a]) << 32) | a;
+        # pragma omp atomic
+        ++C.offset[source[a]];
+    }
+    exclusive_scan(C.offset);
+    radix_sort(keys);
+
+    C.target = VI(A);
+    C.weight = VD(A);
+    # pragma omp parallel for
+    for (size_t k = 0; k < A; ++k) {
+        uint32_t a = uint32_t(keys[k]);
+        C.target[k] = dest[a];
+        C.weight[k] = weight[a];
+    }
+    return C;
+}
 
-        adjacency[v].push_back(make_pair(u, e.w));
-        threshold[u] += e.w;
+Graph::Graph(const VE &Edges, const VD& pg, const VD& bw, bool directed, double th) {
+    E = static_cast<int>(Edges.size());
+    this->directed = directed;
 
-        if (not directed) {
-            adjacency[u].push_back(make_pair(v, e.w));
-            threshold[v] += e.w;
+    // Relabel the nodes in order of first appearance. The endpoints are
+    // sorted by identifier, keeping their position in the edge list in the
+    // low bits, so the first key of every identifier is its first appearance
+    size_t P = size_t(2)*E;
+    vector<uint64_t> keys(P);
+    # pragma omp parallel for
+    for (size_t i = 0; i < E; ++i) {
+        keys[2*i] = (uint64_t(uint32_t(Edges[i].v)) << 32) | (2*i);
+        keys[2*i + 1] = (uint64_t(uint32_t(Edges[i].u)) << 32) | (2*i + 1);
+    }
+    radix_sort(keys);
+
+    auto starts_identifier = [&](size_t j) { return j == 0 or (keys[j] >> 32) != (keys[j-1] >> 32); };
+    VI first(P + 1, 0);
+    # pragma omp parallel for
+    for (size_t j = 0; j < P; ++j)
+        if (starts_identifier(j)) first[uint32_t(keys[j])] = 1;
+    N = exclusive_scan(first);
+
+    // Every endpoint gets the label of the first appearance of its identifier
+    VI label(P);
+    mapping = VI(N);
+    # pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t j = 0; j < P; ++j) {
+        if (not starts_identifier(j)) continue;
+        int l = first[uint32_t(keys[j])];
+        mapping[l] = int(keys[j] >> 32);
+        for (size_t k = j; k < P and (keys[k] >> 32) == (keys[j] >> 32); ++k)
+            label[uint32_t(keys[k])] = l;
+    }
+    keys = vector<uint64_t>();
+    first = VI();
+    build_id_index();
+
+    // Arcs in the order the edges were given, an undirected edge giving
+    // one arc in each direction
+    size_t A = directed ? E : P;
+    VI source(A), dest(A);
+    VD weight(A);
+    # pragma omp parallel for
+    for (size_t i = 0; i < E; ++i) {
+        int v = label[2*i];
+        int u = label[2*i + 1];
+        if (directed) {
+            source[i] = v;
+            dest[i] = u;
+            weight[i] = Edges[i].w;
+        }
+        else {
+            source[2*i] = v;
+            dest[2*i] = u;
+            source[2*i + 1] = u;
+            dest[2*i + 1] = v;
+            weight[2*i] = weight[2*i + 1] = Edges[i].w;
         }
-        else predecessors[u].push_back(make_pair(v, e.w));
     }
+    adjacency = build_csr(N, source, dest, weight);
+    if (directed) predecessors = build_csr(N, dest, source, weight);
+
+    // The threshold starts as the weighted in-degree, summed in edge order
+    const CSR& in = in_edges();
+    threshold.value = VD(N, 0);
+    # pragma omp parallel for
+    for (uint u = 0; u < N; ++u)
+        for (int k = in.offset[u]; k < in.offset[u+1]; ++k)
+            threshold.value[u] += in.weight[k];
 
-    cout << endl;
-    N = static_cast<int>(threshold.size());
+    update_contributions();
     betweenness.assign(bw.begin(), bw.end());
     pagerank.assign(pg.begin(), pg.end());
 }
 
-void Graph::assign_thresholds(string mode){
+void Graph::assign_thresholds(Thresholds& ths, string mode, const Philox& gen) const {
+  // Every node draws from its own block, so the nodes go in parallel
+  int n = ths.value.size();
   if(mode == "random_uniform"){
     //asignacion de umbrales aleatorios uniformemente distribuido
-    int n = this->threshold.size();
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::uniform_real_distribution<double> dist(0.0,1.0);
-
-    for (double &v : this->threshold)
-        v = int(v * dist(generator)) + 1;
+    # pragma omp parallel for
+    for (int u = 0; u < n; ++u)
+        ths.value[u] = int(ths.value[u] * gen.uniform(u)) + 1;
   }
   else if(mode == "random_uniform_0-0.5"){
     //asignacion de umbrales aleatorios uniformemente distribuido
-    int n = this->threshold.size();
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::uniform_real_distribution<double> dist(0.0,0.5);
-
-    for (double &v : this->threshold)
-        v = int(v * dist(generator)) + 1;
+    # pragma omp parallel for
+    for (int u = 0; u < n; ++u)
+        ths.value[u] = int(ths.value[u] * 0.5*gen.uniform(u)) + 1;
   }
   else if(mode == "random_uniform_0.5-1"){
     //asignacion de umbrales aleatorios uniformemente distribuido
-    int n = this->threshold.size();
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::uniform_real_distribution<double> dist(0.5,1.0);
-
-    for (double &v : this->threshold)
-        v = int(v * dist(generator)) + 1;
+    # pragma omp parallel for
+    for (int u = 0; u < n; ++u)
+        ths.value[u] = int(ths.value[u] * (0.5 + 0.5*gen.uniform(u))) + 1;
   }
   else if(mode == "random_normal"){
     //asignacion de umbrales aleatorios siguiendo una distribucion de probabilidad normal
-    int n = this->threshold.size();
-    //generator using mersenne twister engine
-    std::random_device rd;
-    std::mt19937 generator(rd());
     //distribucion normal centrada en el 0.5 y con desviacion estandar de 1/6
-    std::normal_distribution<double> dist(0.5,0.166666667);
     //los valores que den mas o menos de 1 o 0 seran redondeados. aprox el 0.3%
-    for (double &v : this->threshold){
-        double x = dist(generator);
+    # pragma omp parallel for
+    for (int u = 0; u < n; ++u) {
+        double x = 0.5 + 0.166666667*gen.normal(u);
         if(x < 0.0) x = 0.0;
         if(x > 1.0) x = 1.0;
-        v = int(v * x) + 1;
-      }
+        ths.value[u] = int(ths.value[u] * x) + 1;
+    }
   }
 
+  update_threshold_counts(ths);
+}
+
+// Reads the rows "node,rank" of a ranking file, skipping its header
+static void read_ranking(const string& path, VI& nodes, VD& ranks) {
+  ifstream file(path, ios::binary);
+  string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  const char* p = data.data();
+  const char* end = p + data.size();
+  p = find(p, end, '\n');                     // discard headers
+  while (p < end) {
+    const char* eol = find(++p, end, '\n');
+    while (p < eol and (*p == ' ' or *p == '\t')) ++p;
+    int node;
+    double rank;
+    auto r = from_chars(p, eol, node);
+    if (r.ec == errc() and r.ptr < eol and *r.ptr == ',') {
+      const char* q = r.ptr + 1;
+      while (q < eol and *q == ' ') ++q;
+      if (from_chars(q, eol, rank).ec == errc()) {
+        nodes.push_back(node);
+        ranks.push_back(rank);
+      }
+    }
+    p = eol;
+  }
 }
 
-void Graph::assign_thresholds(string mode, string filename, bool cpl){
+void Graph::assign_thresholds(Thresholds& ths, string mode, string filename, bool cpl) const {
   string path;
   if(mode == "fltr"){
     path = "../Experiments/old_FLTR/";
@@ -119,175 +256,620 @@ void Graph::assign_thresholds(string mode, string filename, bool cpl){
   }else if(mode == "pagerank"){
     path = "../Experiments/pagerank/";
   }
-  if(cpl == false){
-    ifstream file(path + filename);
-    string line;
-    getline(file,line); //discard headers
-    while(getline(file,line)){
-      //ir linea por linea
-      istringstream s(line);
-      string field;
-      getline(s,field,',');
-      int node = stoi(field);
-      //get reverse mapping of node number
-      vector<int>::iterator idx = find(this->mapping.begin(),this->mapping.end(),node);
-      if(idx != this->mapping.end())
-        node = distance(this->mapping.begin(),idx);
-      else
-        cout << node << " not found" << endl;
-
-      getline(s,field,',');
-      double rank = stod(field);
-
-      this->threshold[node]=int(this->threshold[node] * rank) + 1;
-    }
-  }
-  else{
-    ifstream file(path + filename);
-    string line;
-    getline(file,line); //discard headers
-    while(getline(file,line)){
-      //ir linea por linea
-      istringstream s(line);
-      string field;
-      getline(s,field,',');
-      int node = stoi(field);
-      //get reverse mapping of node number
-      vector<int>::iterator idx = find(this->mapping.begin(),this->mapping.end(),node);
-      if(idx != this->mapping.end())
-        node = distance(this->mapping.begin(),idx);
-      else
-        cout << node << " not found" << endl;
-
-      getline(s,field,',');
-      double rank = 1.0 - stod(field);
-
-      this->threshold[node]=int(this->threshold[node] * rank) + 1;
-    }
+  VI nodes;
+  VD ranks;
+  read_ranking(path + filename, nodes, ranks);
+
+  //get reverse mapping of node numbers
+  for (uint i = 0; i < nodes.size(); ++i) {
+    int node = internal_id(nodes[i]);
+    if (node < 0) cout << nodes[i] << " not found" << endl;
+    nodes[i] = node;
   }
+
+  //complementary ranks use 1 - rank
+  double sign = cpl ? -1.0 : 1.0;
+  double shift = cpl ? 1.0 : 0.0;
+  # pragma omp simd
+  for (uint i = 0; i < ranks.size(); ++i)
+    ranks[i] = shift + sign*ranks[i];
+
+  for (uint i = 0; i < nodes.size(); ++i)
+    if (nodes[i] >= 0)
+      ths.value[nodes[i]] = int(ths.value[nodes[i]] * ranks[i]) + 1;
+  update_threshold_counts(ths);
+}
+
+int Graph::internal_id(int node) const {
+  uint64_t key = uint64_t(uint32_t(node)) << 32;
+  auto it = lower_bound(id_index.begin(), id_index.end(), key);
+  if (it == id_index.end() or (*it >> 32) != (key >> 32)) return -1;
+  return int(uint32_t(*it));
+}
+
+void Graph::build_id_index() {
+  id_index = vector<uint64_t>(N);
+  # pragma omp parallel for
+  for (uint v = 0; v < N; ++v)
+    id_index[v] = (uint64_t(uint32_t(mapping[v])) << 32) | v;
+  radix_sort(id_index);
 }
 
-void Graph::assign_thresholds(double th){
-  for (double &v : this->threshold)
+void Graph::assign_thresholds(Thresholds& ths, double th) const {
+  for (double &v : ths.value)
         v = int(v * th) + 1;
+  update_threshold_counts(ths);
+}
+
+void Graph::assign_thresholds(Thresholds& ths, const VD& values) const {
+    for (uint i = 0; i < ths.value.size(); ++i)
+        ths.value[i] = values[i];
+    update_threshold_counts(ths);
+}
+
+void Graph::assign_threshold(Thresholds& ths, uint v, double th) const {
+    ths.value[v] = th;
+    update_threshold_count(ths, v);
+}
+
+void Graph::update_contributions() {
+    VD influence(adjacency.target.size());
+    VD total(N, 0);
+    unit_weights = true;
+    for (uint k = 0; k < adjacency.target.size(); ++k) {
+        influence[k] = adjacency.weight[k]*in_degree(adjacency.target[k]);
+        total[adjacency.target[k]] += influence[k];
+        if (adjacency.weight[k] != 1) unit_weights = false;
+    }
+
+    // Up to 32 fractional bits, as long as every sum stays below 2^61
+    double largest = 0;
+    for (uint v = 0; v < N; ++v) largest = max(largest, total[v]);
+    int bits = 32;
+    while (bits > -32 and ldexp(largest + 1, bits) >= 0x1p61) --bits;
+    influence_scale = ldexp(1.0, bits);
+    contribution = VL(influence.size());
+    max_influence = VL(N, 0);
+    for (uint k = 0; k < influence.size(); ++k) {
+        contribution[k] = to_fixed(influence[k]);
+        max_influence[adjacency.target[k]] += contribution[k];
+    }
+    const CSR& in = in_edges();
+    in_contribution = VL(in.target.size());
+    for (uint v = 0; v < N; ++v)
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k)
+            in_contribution[k] = to_fixed(in.weight[k]*in_degree(v));
+    update_threshold_counts(threshold);
 }
 
-void Graph::assign_thresholds(VD& ths) {
-    for (uint i = 0; i < threshold.size(); ++i)
-        threshold[i] = ths[i];
+int Graph::threshold_count_for(uint v, double th) const {
+    // Smallest number of influenced in-neighbours k such that
+    // k*in_degree(v) >= th, as the spread would compute it
+    double d = in_degree(v);
+    if (d == 0) return INT_MAX;
+    double k = max(0.0, ceil(th/d));
+    while (k > 0 and (k - 1)*d >= th) --k;
+    while (k*d < th) ++k;
+    return min(k, double(INT_MAX));
 }
 
-void Graph::assign_threshold(uint v, double th) {
-    threshold[v] = th;
+void Graph::update_threshold_count(Thresholds& ths, uint v) const {
+    if (unit_weights) ths.count[v] = threshold_count_for(v, ths.value[v]);
+    else ths.fixed[v] = to_fixed(ths.value[v]);
 }
 
-bool Graph::is_subset(const USI& set_a, const USI& set_b) const {
-    auto const end = set_b.end();
-    for (const auto& elem: set_a)
-        if (set_b.find(elem) == end)
-            return false;
-    return true;
+void Graph::update_threshold_counts(Thresholds& ths) const {
+    if (unit_weights) ths.count.resize(N);
+    else ths.fixed.resize(N);
+    for (uint v = 0; v < N; ++v) update_threshold_count(ths, v);
 }
 
-uint Graph::intersection_size(const USI& set_a, const USI& set_b) const {
-    uint size = 0;
-    auto const end = set_b.end();
-    for (const auto& elem: set_a)
-        if (set_b.find(elem) != end)
-            ++size;
-    return size;
+bool Graph::is_subset(const NodeSet& set_a, const NodeSet& set_b) const {
+    return set_a.is_subset_of(set_b);
+}
+
+uint Graph::intersection_size(const NodeSet& set_a, const NodeSet& set_b) const {
+    return set_a.intersection_size(set_b);
 }
 
 uint Graph::in_degree(uint v) const {
-    return (directed ? predecessors[v].size() : adjacency[v].size());
+    return (directed ? predecessors.degree(v) : adjacency.degree(v));
 }
 
 uint Graph::out_degree(uint v) const {
-    return adjacency[v].size();
+    return adjacency.degree(v);
+}
+
+void Graph::expand_influence(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes) const {
+    SpreadWorkspace ws;
+    expand_influence(initial_set, ths, influenced_nodes, ws);
 }
 
-void Graph::expand_influence(USI& initial_set, USI& influenced_nodes) {
-    VInfo info(N, Info());
-    QI Q;
+void Graph::expand_influence(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes, SpreadWorkspace& ws) const {
+    influenced_nodes.resize(N);
+    ws.reset(N);
+    VI& Q = ws.frontier;
     for (uint u : initial_set) {
-        info[u].last_spread_level = 0;
-        info[u].influenced = true;
-        Q.push(u);
+        ws.touch(u);
+        ws.last_spread_level[u] = 0;
+        ws.influenced[u] = true;
+        Q.push_back(u);
         influenced_nodes.insert(u);
     }
 
-    while (not Q.empty()) {
-        int v = Q.front();
-        Q.pop();
-        // # pragma omp parallel for
-        for (auto edge : adjacency[v]) {
-            // Edge (v, u) with weight w
-            uint u = edge.first;
-            double w = edge.second;
-            if (not info[u].influenced) {
-                info[u].influence += w*in_degree(u);
-                if (info[u].influence >= threshold[u]) {
-                    info[u].influenced = true;
-                    // # pragma omp critical
-                    // {
-                    Q.push(u);
-                    // }
+    for (uint head = 0; head < Q.size(); ++head) {
+        int v = Q[head];
+        for (int k = adjacency.offset[v]; k < adjacency.offset[v+1]; ++k) {
+            // Edge (v, u), adding its precomputed contribution to u
+            uint u = adjacency.target[k];
+            ws.touch(u);
+            if (not ws.influenced[u]) {
+                bool activated;
+                if (unit_weights) activated = ++ws.count[u] >= ths.count[u];
+                else activated = (ws.influence[u] += contribution[k]) >= ths.fixed[u];
+                if (activated) {
+                    ws.influenced[u] = true;
+                    Q.push_back(u);
                     influenced_nodes.insert(u);
                 }
-                info[u].last_spread_level = info[v].last_spread_level + 1;
+                ws.last_spread_level[u] = ws.last_spread_level[v] + 1;
             }
         }
     }
 }
 
-Graph Graph::stochastic() const {
-  Graph G = Graph();
-  G.N = this->N;
-  G.E = this->E;
-  G.directed = this->directed;
-  G.mapping = this->mapping;
+void Graph::spread_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, const NodeSet* target_set, VI& reached, BatchWorkspace& ws) const {
+    uint K = scenarios.size();
+    uint64_t all = (K == 64) ? ~uint64_t(0) : (uint64_t(1) << K) - 1;
+    ws.reset(N, K);
+    reached = VI(K, 0);
+
+    // Thresholds replaced by the scenarios
+    VI scenario_count(K);
+    VL scenario_fixed(K);
+    for (uint b = 0; b < K; ++b) {
+        const SpreadScenario& s = scenarios[b];
+        if (s.node < 0) continue;
+        ws.touch(s.node);
+        ws.overridden[s.node] |= uint64_t(1) << b;
+        if (unit_weights) scenario_count[b] = threshold_count_for(s.node, s.threshold);
+        else scenario_fixed[b] = to_fixed(s.threshold);
+    }
 
-  VVPID adj;
-  for (const VPID &V : this->adjacency)
-  {
-    VPID aux;
-    double sw = 0;
-    for (PID v : V) sw += v.second;
+    auto seed = [&](uint u, uint64_t bits) {
+        ws.touch(u);
+        if (ws.pending[u] == 0 and ws.mask[u] == 0) ws.queue.push_back(u);
+        ws.mask[u] |= bits;
+        ws.pending[u] |= bits;
+    };
+    for (uint u : initial_set) seed(u, all);
+    for (uint b = 0; b < K; ++b) {
+        int r = scenarios[b].removed;
+        if (r >= 0 and initial_set.contains(r)) {
+            ws.mask[r] &= ~(uint64_t(1) << b);
+            ws.pending[r] &= ~(uint64_t(1) << b);
+        }
+    }
+    for (uint b = 0; b < K; ++b)
+        if (scenarios[b].added >= 0) seed(scenarios[b].added, uint64_t(1) << b);
+
+    // Scenarios that already reached all the targets they can influence
+    uint64_t done = 0;
+    VI goal;
+    if (target_set != nullptr) {
+        auto is_seed = [&](uint x, uint b) {
+            const SpreadScenario& s = scenarios[b];
+            return int(x) == s.added or (initial_set.contains(x) and int(x) != s.removed);
+        };
+        auto can_be_influenced_in = [&](uint x, uint b) {
+            if (int(x) != scenarios[b].node) return can_be_influenced(x, ths);
+            if (unit_weights) return int(in_degree(x)) >= scenario_count[b];
+            return max_influence[x] >= scenario_fixed[b];
+        };
+        uint unreachable = unreachable_targets(initial_set, ths, *target_set);
+        goal = VI(K);
+        for (uint b = 0; b < K; ++b) {
+            const SpreadScenario& s = scenarios[b];
+            int special[3] = {s.added, s.removed, s.node};
+            int g = target_set->size() - unreachable;
+            for (int i = 0; i < 3; ++i) {
+                int x = special[i];
+                if (x < 0 or not target_set->contains(x)) continue;
+                if ((i > 0 and x == special[0]) or (i > 1 and x == special[1])) continue;
+                bool before = not initial_set.contains(x) and not can_be_influenced(x, ths);
+                bool after = not is_seed(x, b) and not can_be_influenced_in(x, b);
+                g += int(before) - int(after);
+            }
+            goal[b] = g;
+        }
+        for (uint u : ws.queue)
+            if (target_set->contains(u))
+                for (uint64_t bits = ws.mask[u]; bits; bits &= bits - 1)
+                    ++reached[__builtin_ctzll(bits)];
+        for (uint b = 0; b < K; ++b)
+            if (reached[b] >= goal[b]) done |= uint64_t(1) << b;
+    }
 
-    if (sw > 0) for (PID v : V) aux.push_back(make_pair(v.first,v.second/sw));
-    else for (PID v : V) aux.push_back(make_pair(v.first,0));
-    adj.push_back(aux);
-  }
-  G.adjacency = adj;
+    for (uint head = 0; head < ws.queue.size() and done != all; ++head) {
+        int v = ws.queue[head];
+        uint64_t bits = ws.pending[v] & ~done;
+        ws.pending[v] = 0;
+        if (bits == 0) continue;
+        for (int k = adjacency.offset[v]; k < adjacency.offset[v+1]; ++k) {
+            uint u = adjacency.target[k];
+            ws.touch(u);
+            uint64_t relaxed = bits & ~ws.mask[u];
+            if (relaxed == 0) continue;
+
+            uint s = ws.sums(u);
+            uint64_t gained = 0;
+            for (; relaxed; relaxed &= relaxed - 1) {
+                uint b = __builtin_ctzll(relaxed);
+                bool own = (ws.overridden[u] >> b) & 1;
+                bool activated;
+                if (unit_weights) activated = ++ws.count[s + b] >= (own ? scenario_count[b] : ths.count[u]);
+                else activated = (ws.influence[s + b] += contribution[k]) >= (own ? scenario_fixed[b] : ths.fixed[u]);
+                if (activated) gained |= uint64_t(1) << b;
+            }
+            if (gained == 0) continue;
+
+            if (ws.pending[u] == 0) ws.queue.push_back(u);
+            ws.mask[u] |= gained;
+            ws.pending[u] |= gained;
+            if (target_set != nullptr and target_set->contains(u)) {
+                for (; gained; gained &= gained - 1) {
+                    uint b = __builtin_ctzll(gained);
+                    if (++reached[b] >= goal[b]) done |= uint64_t(1) << b;
+                }
+                if (done == all) break;
+            }
+        }
+    }
+}
 
-  if (G.directed)
-  {
-    VVPID pred;
-    for (const VPID &V : this->predecessors)
-    {
-      VPID aux;
-      double sw = 0;
-      for (PID v : V) sw += v.second;
+void Graph::expand_influence_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, vector<NodeSet>& influenced_nodes, BatchWorkspace& ws) const {
+    VI reached;
+    spread_batch(initial_set, ths, scenarios, nullptr, reached, ws);
+    influenced_nodes.assign(scenarios.size(), NodeSet(N));
+    for (uint u : ws.queue)
+        for (uint64_t bits = ws.mask[u]; bits; bits &= bits - 1)
+            influenced_nodes[__builtin_ctzll(bits)].insert(u);
+}
 
-      if (sw > 0) for (PID v : V) aux.push_back(make_pair(v.first,v.second/sw));
-      else for (PID v : V) aux.push_back(make_pair(v.first,0));
+void Graph::influenced_targets_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, const NodeSet& target_set, VI& reached, BatchWorkspace& ws) const {
+    spread_batch(initial_set, ths, scenarios, &target_set, reached, ws);
+}
 
-      pred.push_back(aux);
+// Switching points between pushing and pulling the influence of a level,
+// as in direction optimizing BFS (Beamer et al.)
+const long PULL_ALPHA = 14;
+const long PUSH_BETA = 24;
+
+void Graph::expand_influence_parallel(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes) const {
+    // Counts and fixed point sums add up to the same in any order, so
+    // the threads may add the influence of a level in any order
+    influenced_nodes.resize(N);
+    const CSR& in = in_edges();
+    VL influence(N, 0);
+    VI count(N, 0);
+    vector<char> influenced(N, false);
+    vector<char> in_frontier(N, false);
+
+    VI frontier;
+    long unexplored = in.target.size();
+    for (uint u : initial_set) {
+        influenced[u] = true;
+        frontier.push_back(u);
+        influenced_nodes.insert(u);
+        unexplored -= in_degree(u);
     }
-    G.predecessors = pred;
-  }
 
-  G.threshold = VD(G.N,1/2 + 1);
+    bool pull = false;
+    while (not frontier.empty()) {
+        long frontier_edges = 0;
+        for (int v : frontier) frontier_edges += out_degree(v);
+        if (not pull and frontier_edges > unexplored/PULL_ALPHA) pull = true;
+        else if (pull and long(frontier.size()) < long(N)/PUSH_BETA) pull = false;
+
+        VI next;
+        if (pull) {
+            for (int v : frontier) in_frontier[v] = true;
+            // Every node sums the influence of its predecessors in the frontier
+            # pragma omp parallel
+            {
+                VI local;
+                # pragma omp for schedule(dynamic, 1024) nowait
+                for (uint u = 0; u < N; ++u) {
+                    if (influenced[u]) continue;
+                    bool relaxed = false;
+                    for (int k = in.offset[u]; k < in.offset[u+1]; ++k) {
+                        if (not in_frontier[in.target[k]]) continue;
+                        if (unit_weights) ++count[u];
+                        else influence[u] += in_contribution[k];
+                        relaxed = true;
+                    }
+                    if (relaxed and (unit_weights ? count[u] >= ths.count[u] : influence[u] >= ths.fixed[u]))
+                        local.push_back(u);
+                }
+                # pragma omp critical
+                next.insert(next.end(), local.begin(), local.end());
+            }
+            for (int v : frontier) in_frontier[v] = false;
+        }
+        else {
+            // Every frontier node adds its influence to its successors, and
+            // the thread that takes a node over its threshold claims it
+            vector<char>& claimed = in_frontier;
+            # pragma omp parallel
+            {
+                VI local;
+                # pragma omp for schedule(dynamic, 64) nowait
+                for (uint i = 0; i < frontier.size(); ++i) {
+                    int v = frontier[i];
+                    for (int k = adjacency.offset[v]; k < adjacency.offset[v+1]; ++k) {
+                        uint u = adjacency.target[k];
+                        if (influenced[u]) continue;
+                        bool reached;
+                        if (unit_weights) {
+                            int c;
+                            # pragma omp atomic capture
+                            c = ++count[u];
+                            reached = c >= ths.count[u];
+                        }
+                        else {
+                            int64_t c;
+                            # pragma omp atomic capture
+                            c = influence[u] += contribution[k];
+                            reached = c >= ths.fixed[u];
+                        }
+                        if (reached) {
+                            char was_claimed;
+                            # pragma omp atomic capture
+                            { was_claimed = claimed[u]; claimed[u] = true; }
+                            if (not was_claimed) local.push_back(u);
+                        }
+                    }
+                }
+                # pragma omp critical
+                next.insert(next.end(), local.begin(), local.end());
+            }
+            for (int u : next) claimed[u] = false;
+        }
+
+        for (int u : next) {
+            influenced[u] = true;
+            influenced_nodes.insert(u);
+            unexplored -= in_degree(u);
+        }
+        frontier.swap(next);
+    }
+}
+
+bool Graph::can_be_influenced(uint v, const Thresholds& ths) const {
+    if (unit_weights) return int(in_degree(v)) >= ths.count[v];
+    return max_influence[v] >= ths.fixed[v];
+}
+
+uint Graph::unreachable_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set) const {
+    uint unreachable = 0;
+    for (uint t : target_set)
+        if (not initial_set.contains(t) and not can_be_influenced(t, ths))
+            ++unreachable;
+    return unreachable;
+}
+
+uint Graph::spread_to_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, uint goal, SpreadWorkspace& ws) const {
+    ws.reset(N);
+    VI& Q = ws.frontier;
+    uint reached = 0;
+    for (uint u : initial_set) {
+        ws.touch(u);
+        ws.influenced[u] = true;
+        Q.push_back(u);
+        if (target_set.contains(u)) ++reached;
+    }
+    if (reached >= goal) return reached;
+
+    for (uint head = 0; head < Q.size(); ++head) {
+        int v = Q[head];
+        for (int k = adjacency.offset[v]; k < adjacency.offset[v+1]; ++k) {
+            uint u = adjacency.target[k];
+            ws.touch(u);
+            if (not ws.influenced[u]) {
+                bool activated;
+                if (unit_weights) activated = ++ws.count[u] >= ths.count[u];
+                else activated = (ws.influence[u] += contribution[k]) >= ths.fixed[u];
+                if (activated) {
+                    ws.influenced[u] = true;
+                    Q.push_back(u);
+                    if (target_set.contains(u) and ++reached >= goal)
+                        return reached;
+                }
+            }
+        }
+    }
+    return reached;
+}
+
+uint Graph::influenced_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, SpreadWorkspace& ws) const {
+    // Once the targets that can still be influenced are reached the rest
+    // of the spread cannot change the answer
+    uint goal = target_set.size() - unreachable_targets(initial_set, ths, target_set);
+    return spread_to_targets(initial_set, ths, target_set, goal, ws);
+}
+
+bool Graph::influences_all(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, SpreadWorkspace& ws) const {
+    if (unreachable_targets(initial_set, ths, target_set) > 0) return false;
+    return spread_to_targets(initial_set, ths, target_set, target_set.size(), ws) == target_set.size();
+}
+
+// Inverse of the sum of the weights of every row, 0 for empty rows
+static VD inverse_row_sums(const CSR& C, uint N) {
+  VD inv(N, 0);
+  # pragma omp parallel for
+  for (uint v = 0; v < N; ++v) {
+    double sw = 0;
+    for (int k = C.offset[v]; k < C.offset[v+1]; ++k) sw += C.weight[k];
+    if (sw > 0) inv[v] = 1/sw;
+  }
+  return inv;
+}
 
-  return G;
+StochasticView Graph::stochastic() const {
+  StochasticView P;
+  P.G = this;
+  P.inv_out = inverse_row_sums(adjacency, N);
+  P.inv_in = directed ? inverse_row_sums(predecessors, N) : P.inv_out;
+  return P;
 }
 
 VI Graph::dangling_nodes() const {
   VI res;
-  for (int v = 0; v < N; ++v) if (adjacency[v].empty()) res.push_back(v);
+  for (uint v = 0; v < N; ++v) if (adjacency.degree(v) == 0) res.push_back(v);
   return res;
 }
 
+VD Graph::compute_pagerank(double alpha, uint max_iter, double tol) const {
+  VD rank(N, 1.0/N);
+  if (N == 0) return rank;
+
+  // The rank of u goes to its successors in proportion to the weights
+  // of its out edges, and the rank of dangling nodes to every node
+  StochasticView P = stochastic();
+  VI dangling = dangling_nodes();
+  const CSR& in = in_edges();
+  VD share(N), next(N);
+  for (uint it = 0; it < max_iter; ++it) {
+    double dangling_rank = 0;
+    for (int v : dangling) dangling_rank += rank[v];
+    double base = (alpha*dangling_rank + 1 - alpha)/N;
+
+    # pragma omp parallel for
+    for (uint u = 0; u < N; ++u) share[u] = rank[u]*P.inv_out[u];
+    double err = 0;
+    # pragma omp parallel for reduction(+: err)
+    for (uint v = 0; v < N; ++v) {
+      double s = 0;
+      for (int k = in.offset[v]; k < in.offset[v+1]; ++k) s += in.weight[k]*share[in.target[k]];
+      next[v] = base + alpha*s;
+      err += fabs(next[v] - rank[v]);
+    }
+    rank.swap(next);
+    if (err < N*tol) return rank;
+  }
+  cerr << "pagerank did not converge in " << max_iter << " iterations" << endl;
+  return rank;
+}
+
+// Adjacency without weights, self loops or repeated edges, as the
+// shortest paths of betweenness count each neighbour once
+static CSR simple_adjacency(const CSR& C, uint N) {
+  VI target = C.target;
+  CSR S;
+  S.offset = VI(N + 1, 0);
+  # pragma omp parallel for schedule(dynamic, 1024)
+  for (uint v = 0; v < N; ++v) {
+    auto first = target.begin() + C.offset[v];
+    auto last = target.begin() + C.offset[v+1];
+    sort(first, last);
+    last = unique(first, last);
+    S.offset[v] = last - first - count(first, last, int(v));
+  }
+  exclusive_scan(S.offset);
+  S.target = VI(S.offset[N]);
+  # pragma omp parallel for schedule(dynamic, 1024)
+  for (uint v = 0; v < N; ++v) {
+    int k = S.offset[v];
+    for (int j = C.offset[v]; k < S.offset[v+1]; ++j)
+      if (target[j] != int(v) and (j == C.offset[v] or target[j] != target[j-1]))
+        S.target[k++] = target[j];
+  }
+  S.weight = VD(S.target.size(), 1);
+  return S;
+}
+
+// Brandes' algorithm from the given sources, every thread accumulating
+// the dependencies of its sources on its own vector
+static VD brandes(const CSR& S, uint N, const VI& sources) {
+  VD centrality(N, 0);
+  # pragma omp parallel
+  {
+    VD local(N, 0), sigma(N, 0), delta(N, 0);
+    VI dist(N, -1), order;
+    order.reserve(N);
+    # pragma omp for schedule(dynamic, 8)
+    for (size_t i = 0; i < sources.size(); ++i) {
+      int s = sources[i];
+      order.clear();
+      sigma[s] = 1;
+      dist[s] = 0;
+      order.push_back(s);
+      for (size_t head = 0; head < order.size(); ++head) {
+        int v = order[head];
+        for (int k = S.offset[v]; k < S.offset[v+1]; ++k) {
+          int w = S.target[k];
+          if (dist[w] < 0) {
+            dist[w] = dist[v] + 1;
+            order.push_back(w);
+          }
+          if (dist[w] == dist[v] + 1) sigma[w] += sigma[v];
+        }
+      }
+      // Dependencies in reverse BFS order, the predecessors of w being
+      // its neighbours one level closer to s
+      for (size_t j = order.size(); j-- > 0;) {
+        int w = order[j];
+        for (int k = S.offset[w]; k < S.offset[w+1]; ++k) {
+          int v = S.target[k];
+          if (dist[v] == dist[w] + 1) delta[w] += sigma[w]/sigma[v]*(1 + delta[v]);
+        }
+        if (w != s) local[w] += delta[w];
+      }
+      for (int v : order) {
+        sigma[v] = delta[v] = 0;
+        dist[v] = -1;
+      }
+    }
+    # pragma omp critical
+    for (uint v = 0; v < N; ++v) centrality[v] += local[v];
+  }
+  return centrality;
+}
+
+VD Graph::compute_betweenness() const {
+  VI sources(N);
+  for (uint v = 0; v < N; ++v) sources[v] = v;
+  VD centrality = brandes(simple_adjacency(adjacency, N), N, sources);
+  if (N > 2)
+    for (double& c : centrality) c /= double(N - 1)*(N - 2);
+  return centrality;
+}
+
+uint Graph::betweenness_samples(uint N, double epsilon, double delta) {
+  // Every sample is a dependency scaled to [0, N/(N-1)]; Hoeffding's
+  // bound and a union bound over the N nodes give the number of samples
+  if (N <= 2) return N;
+  double range = double(N)/(N - 1);
+  double k = range*range*log(2.0*N/delta)/(2*epsilon*epsilon);
+  return uint(min(ceil(k), double(UINT_MAX)));
+}
+
+VD Graph::compute_betweenness(double epsilon, double delta, uint seed) const {
+  uint k = betweenness_samples(N, epsilon, delta);
+  if (k >= N) return compute_betweenness();
+
+  // Sources drawn with replacement, so the samples are independent, the
+  // source i from the block i of the stream
+  Philox gen(seed, 0, 0, 0, PICK_SOURCES);
+  VI sources(k);
+  # pragma omp parallel for
+  for (uint i = 0; i < k; ++i) sources[i] = min<uint>(gen.uniform(i)*N, N - 1);
+  VD centrality = brandes(simple_adjacency(adjacency, N), N, sources);
+  double scale = double(N)/k/((double(N) - 1)*(N - 2));
+  for (double& c : centrality) c *= scale;
+  return centrality;
+}
+
 void Graph::print() const {
     if (N > 100) {
         cout << "Graph is too big to print!" << endl;
@@ -297,10 +879,10 @@ void Graph::print() const {
     cout << "ADJACENCIES" << endl;
     for (uint u = 0; u < N; ++u) {
         cout << u << ": ";
-        if (adjacency[u].empty())
+        if (adjacency.degree(u) == 0)
             cout << "-";
-        for (uint v = 0; v < adjacency[u].size(); ++v) {
-            cout << "(" << adjacency[u][v].first << ", " << adjacency[u][v].second << ")" << " ";
+        for (int k = adjacency.offset[u]; k < adjacency.offset[u+1]; ++k) {
+            cout << "(" << adjacency.target[k] << ", " << adjacency.weight[k] << ")" << " ";
         }
         cout << endl;
     }
@@ -317,6 +899,6 @@ void Graph::print() const {
     // }
     cout << "THRESHOLDS" << endl;
     for (uint u = 0; u < N; ++u)
-        cout << u << ": " << threshold[u] << " ";
+        cout << u << ": " << threshold.value[u] << " ";
     cout << endl << "------------" << endl;
 }
\ No newline at end of file
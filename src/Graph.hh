@@ -1,97 +1,345 @@
-# ifndef GRAPH_HH
-# define GRAPH_HH
-
-# include <vector>
-# include <map>
-# include <unordered_map>
-# include <unordered_set>
-# include <queue>
-# include <string>
-
-using namespace std;
-
-struct Info {
-    double influence;
-    bool influenced;
-    int last_spread_level;
-
-    Info(): influence(0), influenced(false), last_spread_level(-1) {}
-};
-
-typedef Info Info;
-typedef vector<Info> VInfo;
-
-struct edge
-{
-  int v;
-  int u;
-  double w;
-
-  edge(int v, int u, double w) : v(v), u(u), w(w){}
-};
-
-typedef edge edge;
-typedef vector<edge> VE;
-
-typedef vector<int> VI;
-typedef vector<double> VD;
-
-typedef pair<int,double> PID;
-typedef vector<PID> VPID;
-typedef vector<VPID> VVPID;
-
-typedef unordered_set<int> USI;
-typedef queue<int> QI;
-
-typedef unordered_map<int, int> UMII;
-
-using uint = unsigned int;
-
-
-// using VE = vector<edge>;
-
-// using PID = pair<int, double>;
-// using VI = vector<int>;
-// using VD = vector<double>;
-// using VPID = vector<PID>;
-// using VVPID = vector<VPID>;
-// using USI = unordered_set<int>;
-// using QI = queue<int>;
-
-class Graph {
-
-public:
-    uint N, E = 0;
-    bool directed = false;
-
-    VD threshold;
-    VI mapping;
-    VVPID adjacency;
-    VVPID predecessors;
-
-    VD betweenness;
-    VD pagerank;
-
-    Graph();
-    Graph(const VE &Edges, const VD& pg, const VD& bw, bool directed, double th);
-    
-    //once a graph is created, we have to assign the values for the threshold vector
-    void assign_thresholds(string mode);
-    void assign_thresholds(string mode, string filename, bool cpl);
-    void assign_thresholds(double th);
-    void assign_thresholds(VD& ths);
-    void assign_threshold(uint v, double th);
-
-    bool is_subset(const USI& set_a, const USI& set_b) const;
-    uint intersection_size(const USI& set_a, const USI& set_b) const;
-    uint in_degree(uint v) const;
-    uint out_degree(uint v) const;
-    void expand_influence(USI& initial_set, USI& influenced_nodes);
-
-    Graph stochastic() const;
-    VI dangling_nodes() const;
-
-    void print() const;
-};
-
+# ifndef GRAPH_HH
+# define GRAPH_HH
+
+# include <vector>
+# include <map>
+# include <unordered_map>
+# include <unordered_set>
+# include <queue>
+# include <string>
+# include <algorithm>
+# include <cstdint>
+# include <cmath>
+# include "NodeSet.hh"
+# include "Philox.hh"
+
+using namespace std;
+
+struct edge
+{
+  int v;
+  int u;
+  double w;
+
+  edge(int v, int u, double w) : v(v), u(u), w(w){}
+};
+
+typedef edge edge;
+typedef vector<edge> VE;
+
+typedef vector<int> VI;
+typedef vector<double> VD;
+typedef vector<int64_t> VL;
+
+typedef pair<int,double> PID;
+typedef vector<PID> VPID;
+typedef vector<VPID> VVPID;
+
+typedef unordered_set<int> USI;
+typedef queue<int> QI;
+
+typedef unordered_map<int, int> UMII;
+
+using uint = unsigned int;
+
+// Compressed sparse row storage: the edges leaving node v are
+// target[offset[v]] .. target[offset[v+1]-1], with their weights
+// stored at the same positions in weight
+struct CSR {
+    VI offset;
+    VI target;
+    VD weight;
+
+    uint degree(uint v) const { return offset[v+1] - offset[v]; }
+};
+
+// Reusable per node state of a spread, kept as separate arrays. The
+// values of a node are only valid when its stamp equals the current
+// epoch, so starting a new spread is O(1) instead of O(N). Every
+// thread spreading over the same graph needs its own workspace.
+struct SpreadWorkspace {
+    VL influence;
+    vector<char> influenced;
+    VI last_spread_level;
+    VI count;
+    vector<char> mark;
+    vector<uint> stamp;
+    uint epoch = 0;
+
+    // Nodes in the order they got influenced, used as the BFS queue
+    VI frontier;
+
+    // Secondary list of nodes for the spreads that need two of them
+    VI pending;
+
+    void reset(uint N) {
+        if (stamp.size() != N) {
+            influence.assign(N, 0);
+            influenced.assign(N, false);
+            last_spread_level.assign(N, -1);
+            count.assign(N, 0);
+            mark.assign(N, false);
+            stamp.assign(N, 0);
+            frontier.reserve(N);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            epoch = 1;
+        }
+        frontier.clear();
+        pending.clear();
+    }
+
+    bool valid(uint u) const { return stamp[u] == epoch; }
+
+    void touch(uint u) {
+        if (stamp[u] != epoch) {
+            stamp[u] = epoch;
+            influence[u] = 0;
+            influenced[u] = false;
+            last_spread_level[u] = -1;
+            count[u] = 0;
+            mark[u] = false;
+        }
+    }
+};
+
+
+// using VE = vector<edge>;
+
+// using PID = pair<int, double>;
+// using VI = vector<int>;
+// using VD = vector<double>;
+// using VPID = vector<PID>;
+// using VVPID = vector<VPID>;
+// using USI = unordered_set<int>;
+// using QI = queue<int>;
+
+// One scenario of a batch spread: the common seed set with a node added
+// and/or removed, two different nodes, and optionally one node with a
+// different threshold
+struct SpreadScenario {
+    int added = -1;
+    int removed = -1;
+    int node = -1;
+    double threshold = 0;
+};
+
+const uint MAX_SCENARIOS = 64;
+
+// Reusable state for the batch spreads, stamped like SpreadWorkspace.
+// Every node keeps one bit per scenario, and the nodes that receive
+// influence get a slot with one sum per scenario
+struct BatchWorkspace {
+    vector<uint64_t> mask;
+    vector<uint64_t> pending;
+    vector<uint64_t> overridden;
+    VI slot;
+    vector<uint> stamp;
+    uint epoch = 0;
+
+    VL influence;
+    VI count;
+    uint num_slots = 0;
+    uint width = 0;
+
+    // Nodes with influence still to spread
+    VI queue;
+
+    void reset(uint N, uint scenarios) {
+        if (stamp.size() != N) {
+            mask.assign(N, 0);
+            pending.assign(N, 0);
+            overridden.assign(N, 0);
+            slot.assign(N, -1);
+            stamp.assign(N, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            epoch = 1;
+        }
+        width = scenarios;
+        num_slots = 0;
+        queue.clear();
+    }
+
+    void touch(uint u) {
+        if (stamp[u] != epoch) {
+            stamp[u] = epoch;
+            mask[u] = pending[u] = overridden[u] = 0;
+            slot[u] = -1;
+        }
+    }
+
+    // Position of the first sum of u, cleared the first time it is used
+    uint sums(uint u) {
+        if (slot[u] < 0) {
+            slot[u] = num_slots++;
+            if (influence.size() < num_slots*width) {
+                influence.resize(2*num_slots*width);
+                count.resize(2*num_slots*width);
+            }
+            fill(influence.begin() + slot[u]*width, influence.begin() + num_slots*width, 0);
+            fill(count.begin() + slot[u]*width, count.begin() + num_slots*width, 0);
+        }
+        return slot[u]*width;
+    }
+};
+
+// Thresholds of the nodes, kept apart from the topology so that games
+// can share one read only Graph while each one changes its own copy.
+// When every edge has weight 1 the influence of a node is its number of
+// influenced in-neighbours times its in-degree, so the spreads only count
+// neighbours against count. Otherwise they sum the fixed point influence
+// of the edges (see Graph::contribution) against fixed
+struct Thresholds {
+    VD value;
+    VI count;
+    VL fixed;
+};
+
+class Graph;
+
+// Row stochastic weights of a graph, every edge weight divided by the sum
+// of the weights of its row, computed on the fly from the inverse sums
+// without copying the edges
+struct StochasticView {
+    const Graph* G = nullptr;
+    VD inv_out;     // rows of adjacency, 0 for dangling nodes
+    VD inv_in;      // rows of predecessors (adjacency if undirected)
+
+    double weight(uint u, int k) const;
+    double predecessor_weight(uint v, int k) const;
+};
+
+class Graph {
+
+public:
+    uint N, E = 0;
+    bool directed = false;
+
+    // Base thresholds, the weighted in-degree unless assigned otherwise.
+    // The games start from a copy and never change them
+    Thresholds threshold;
+    VI mapping;
+
+    // Original identifiers sorted, each one with its node in the low bits
+    vector<uint64_t> id_index;
+
+    CSR adjacency;
+    CSR predecessors;
+
+    // Influence that every edge of adjacency adds to its target, its
+    // weight times the in-degree of the target. It is rounded once to
+    // fixed point, so the sums are exact and do not depend on the order
+    // in which a spread adds them
+    VL contribution;
+
+    // The same contributions at the positions of the edges in in_edges()
+    VL in_contribution;
+
+    // Fixed point units per unit of influence, a power of two that keeps
+    // the largest sum of a node far from overflowing
+    double influence_scale = 1;
+
+    // Influence a node gets when all its in-neighbours are influenced, in
+    // fixed point units, summed from the same contributions as the spread
+    VL max_influence;
+
+    // Whether every edge has weight 1, see Thresholds
+    bool unit_weights = false;
+
+    VD betweenness;
+    VD pagerank;
+
+    Graph();
+    Graph(const VE &Edges, const VD& pg, const VD& bw, bool directed, double th);
+    
+    //once a graph is created, we have to assign the values for the threshold vector
+    //the thresholds are given relative to the ones in ths, and the random
+    //modes draw the one of node u from the block u of gen, by default the
+    //thresholds stream of seed 0
+    void assign_thresholds(Thresholds& ths, string mode, const Philox& gen = Philox(0, 0, 0, 0, PICK_THRESHOLDS)) const;
+    void assign_thresholds(Thresholds& ths, string mode, string filename, bool cpl) const;
+    void assign_thresholds(Thresholds& ths, double th) const;
+    void assign_thresholds(Thresholds& ths, const VD& values) const;
+    void assign_threshold(Thresholds& ths, uint v, double th) const;
+
+    // Node of an original identifier, -1 if it is not in the graph
+    int internal_id(int node) const;
+    void build_id_index();
+
+    // Recompute the derived values after changing weights or thresholds
+    void update_contributions();
+    int64_t to_fixed(double influence) const;
+    int threshold_count_for(uint v, double th) const;
+    void update_threshold_count(Thresholds& ths, uint v) const;
+    void update_threshold_counts(Thresholds& ths) const;
+
+    bool is_subset(const NodeSet& set_a, const NodeSet& set_b) const;
+    uint intersection_size(const NodeSet& set_a, const NodeSet& set_b) const;
+    uint in_degree(uint v) const;
+    uint out_degree(uint v) const;
+    const CSR& in_edges() const { return directed ? predecessors : adjacency; }
+
+    // Every spread reads the thresholds from ths, so concurrent games can
+    // spread over the same graph with thresholds of their own
+    void expand_influence(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes) const;
+    void expand_influence(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes, SpreadWorkspace& ws) const;
+    void spread_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, const NodeSet* target_set, VI& reached, BatchWorkspace& ws) const;
+
+    // Spreads of up to 64 variations of a seed set at once, one bit per
+    // scenario. influenced_targets_batch stops once every scenario has
+    // reached the targets it can influence. The threshold game probes its
+    // thresholds with them, while the seed game evaluates the flips of an
+    // agent incrementally over its spread (see IncrementalSpread)
+    void expand_influence_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, vector<NodeSet>& influenced_nodes, BatchWorkspace& ws) const;
+    void influenced_targets_batch(const NodeSet& initial_set, const Thresholds& ths, const vector<SpreadScenario>& scenarios, const NodeSet& target_set, VI& reached, BatchWorkspace& ws) const;
+
+    // Level synchronous version of expand_influence for large spreads. It
+    // pushes the influence of sparse frontiers to their successors and
+    // pulls it from the predecessors when the frontier is dense
+    void expand_influence_parallel(const NodeSet& initial_set, const Thresholds& ths, NodeSet& influenced_nodes) const;
+
+    // Target aware spreads: they only follow the targets that are still
+    // to be influenced and stop as soon as the answer is known
+    bool can_be_influenced(uint v, const Thresholds& ths) const;
+    uint unreachable_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set) const;
+    uint spread_to_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, uint goal, SpreadWorkspace& ws) const;
+    uint influenced_targets(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, SpreadWorkspace& ws) const;
+    bool influences_all(const NodeSet& initial_set, const Thresholds& ths, const NodeSet& target_set, SpreadWorkspace& ws) const;
+
+    StochasticView stochastic() const;
+    VI dangling_nodes() const;
+
+    // PageRank by power iteration with the defaults of networkx, the
+    // rank of dangling nodes spread uniformly
+    VD compute_pagerank(double alpha = 0.85, uint max_iter = 100, double tol = 1e-6) const;
+
+    // Betweenness normalized as networkx does, over unweighted shortest
+    // paths. The sampled version uses enough sources for every value to
+    // be within epsilon of the exact one with probability 1 - delta
+    VD compute_betweenness() const;
+    VD compute_betweenness(double epsilon, double delta, uint seed) const;
+    static uint betweenness_samples(uint N, double epsilon, double delta);
+
+    void print() const;
+};
+
+inline int64_t Graph::to_fixed(double influence) const {
+    // Thresholds out of the range of the sums are clamped
+    double x = min(max(influence*influence_scale, -0x1p62), 0x1p62);
+    return llround(x);
+}
+
+inline double StochasticView::weight(uint u, int k) const {
+    return G->adjacency.weight[k]*inv_out[u];
+}
+
+inline double StochasticView::predecessor_weight(uint v, int k) const {
+    return G->in_edges().weight[k]*inv_in[v];
+}
+
 # endif
\ No newline at end of file
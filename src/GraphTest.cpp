@@ -0,0 +1,87 @@
+/**
+ * @file GraphTest.cpp
+ * @author Jaya García
+ * @brief Checks the batch spreads of Graph against scalar spreads
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "Graph.hh"
+# include <random>
+
+int failures = 0;
+
+void check(bool ok, string what) {
+    if (ok) return;
+    cout << "FAILED: " << what << endl;
+    ++failures;
+}
+
+// Seeds and thresholds of a scenario, spread on their own
+void scalar_spread(const Graph& G, const Thresholds& ths, NodeSet seeds, const SpreadScenario& s, NodeSet& influenced) {
+    if (s.added >= 0) seeds.insert(s.added);
+    if (s.removed >= 0) seeds.erase(s.removed);
+    Thresholds own = ths;
+    if (s.node >= 0) G.assign_threshold(own, s.node, s.threshold);
+    G.expand_influence(seeds, own, influenced);
+}
+
+// Random graphs with 64 random scenarios each: every scenario bit of
+// the batch spread gives the same nodes as a scalar spread
+void batch_matches_scalar(bool unit, uint num_graphs) {
+    mt19937 gen(unit ? 4 : 5);
+    for (uint g = 0; g < num_graphs; ++g) {
+        uint n = 40;
+        VE edges;
+        for (uint v = 0; v < n; ++v)
+            for (uint u = 0; u < n; ++u)
+                if (u != v and gen() % 10 == 0)
+                    edges.push_back(edge(v, u, unit ? 1 : 0.25*(1 + gen() % 8)));
+        if (edges.empty()) continue;
+        Graph G(edges, VD(), VD(), true, 1);
+        Thresholds ths = G.threshold;
+        VD values(G.N);
+        for (uint v = 0; v < G.N; ++v) values[v] = 1 + gen() % 4;
+        G.assign_thresholds(ths, values);
+
+        NodeSet seeds(G.N), targets(G.N);
+        for (uint v = 0; v < G.N; ++v) {
+            if (gen() % 6 == 0) seeds.insert(v);
+            if (gen() % 3 == 0) targets.insert(v);
+        }
+        vector<SpreadScenario> scenarios(MAX_SCENARIOS);
+        for (SpreadScenario& s: scenarios) {
+            if (gen() % 2 == 0) s.added = gen() % G.N;
+            // Adding and removing the same node is not a scenario
+            if (gen() % 2 == 0) s.removed = gen() % G.N;
+            if (s.removed == s.added) s.removed = -1;
+            if (gen() % 2 == 0) {
+                s.node = gen() % G.N;
+                s.threshold = gen() % 5;
+            }
+        }
+
+        BatchWorkspace ws;
+        vector<NodeSet> batch;
+        VI reached;
+        G.expand_influence_batch(seeds, ths, scenarios, batch, ws);
+        G.influenced_targets_batch(seeds, ths, scenarios, targets, reached, ws);
+        for (uint b = 0; b < scenarios.size(); ++b) {
+            NodeSet influenced(G.N);
+            scalar_spread(G, ths, seeds, scenarios[b], influenced);
+            string scenario = string(unit ? "unit" : "weighted") + " graph " + to_string(g) + " scenario " + to_string(b);
+            check(batch[b].size() == influenced.size() and batch[b].is_subset_of(influenced), scenario + " nodes");
+            check(uint(reached[b]) == influenced.intersection_size(targets), scenario + " targets");
+        }
+    }
+}
+
+int main() {
+    batch_matches_scalar(true, 100);
+    batch_matches_scalar(false, 100);
+    if (failures > 0) return 1;
+    cout << "Graph: OK" << endl;
+}
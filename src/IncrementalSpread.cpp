@@ -0,0 +1,296 @@
+/**
+ * @file IncrementalSpread.cpp
+ * @author Jaya García
+ * @brief Implementation of the IncrementalSpread class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "IncrementalSpread.hh"
+# include <functional>
+
+IncrementalSpread::IncrementalSpread(const Graph& H, const Thresholds& ths) : G(H), T(ths) {}
+
+void IncrementalSpread::build(const NodeSet& initial, const NodeSet& target) {
+    seeds = initial;
+    targets = target;
+    influenced = NodeSet(G.N);
+    G.expand_influence(seeds, T, influenced, state);
+
+    order.resize(G.N);
+    for (uint i = 0; i < state.frontier.size(); ++i)
+        order[state.frontier[i]] = i;
+    num_influenced_targets = influenced.intersection_size(targets);
+    num_reachable_targets = targets.size() - G.unreachable_targets(seeds, T, targets);
+}
+
+bool IncrementalSpread::reaches_threshold(uint v, int64_t influence, int count) const {
+    if (G.unit_weights) return count >= T.count[v];
+    return influence >= T.fixed[v];
+}
+
+void IncrementalSpread::add_influence(uint v, int64_t c, SpreadWorkspace& ws) const {
+    if (G.unit_weights) ++ws.count[v];
+    else ws.influence[v] += c;
+}
+
+uint IncrementalSpread::influenced_targets_with(uint u, SpreadWorkspace& ws) const {
+    // An influenced node has already spread to all its neighbours
+    if (influenced.contains(u)) return num_influenced_targets;
+
+    // The spread from u stops once every target that can be influenced is reached
+    uint goal = num_reachable_targets;
+    if (targets.contains(u) and not G.can_be_influenced(u, T)) ++goal;
+
+    ws.reset(G.N);
+    VI& Q = ws.frontier;
+    uint gained = 0;
+    ws.touch(u);
+    ws.influenced[u] = true;
+    Q.push_back(u);
+    if (targets.contains(u)) ++gained;
+
+    // Only the nodes outside the current spread can change, and their
+    // influence is the current one plus the one coming from u
+    for (uint head = 0; head < Q.size(); ++head) {
+        int v = Q[head];
+        for (int k = G.adjacency.offset[v]; k < G.adjacency.offset[v+1]; ++k) {
+            uint w = G.adjacency.target[k];
+            if (influenced.contains(w)) continue;
+            ws.touch(w);
+            if (ws.influenced[w]) continue;
+            add_influence(w, G.contribution[k], ws);
+            bool known = state.valid(w);
+            int64_t influence = (known ? state.influence[w] : 0) + ws.influence[w];
+            int count = (known ? state.count[w] : 0) + ws.count[w];
+            if (reaches_threshold(w, influence, count)) {
+                ws.influenced[w] = true;
+                Q.push_back(w);
+                if (targets.contains(w) and num_influenced_targets + ++gained >= goal)
+                    return num_influenced_targets + gained;
+            }
+        }
+    }
+    return num_influenced_targets + gained;
+}
+
+void IncrementalSpread::pivotal_players(NodeSet& pivotal, SpreadWorkspace& ws) const {
+    pivotal = NodeSet(G.N);
+    const CSR& in = G.in_edges();
+    ws.reset(G.N);
+
+    // A node outside the spread can only influence a target that is not
+    // influenced through a path of nodes outside the spread, so these are
+    // found backwards from the targets not influenced
+    VI& Q = ws.frontier;
+    for (auto t : targets) {
+        if (influenced.contains(t)) continue;
+        ws.touch(t);
+        ws.mark[t] = true;
+        Q.push_back(t);
+    }
+    for (uint head = 0; head < Q.size(); ++head) {
+        int v = Q[head];
+        pivotal.insert(v);
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (influenced.contains(p)) continue;
+            ws.touch(p);
+            if (not ws.mark[p]) {
+                ws.mark[p] = true;
+                Q.push_back(p);
+            }
+        }
+    }
+
+    // An influenced node only depends on in-neighbours of lower activation
+    // level, so the seeds an influenced target depends on are found
+    // backwards from it through decreasing levels
+    VI& R = ws.pending;
+    const VI& level = state.last_spread_level;
+    for (auto t : targets) {
+        if (not influenced.contains(t)) continue;
+        ws.touch(t);
+        ws.influenced[t] = true;
+        R.push_back(t);
+    }
+    for (uint head = 0; head < R.size(); ++head) {
+        int v = R[head];
+        if (seeds.contains(v)) pivotal.insert(v);
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (not influenced.contains(p) or level[p] >= level[v]) continue;
+            ws.touch(p);
+            if (not ws.influenced[p]) {
+                ws.influenced[p] = true;
+                R.push_back(p);
+            }
+        }
+    }
+}
+
+bool IncrementalSpread::affected_by(uint u, const NodeSet& previous, NodeSet& affected, uint max_size, SpreadWorkspace& ws) const {
+    affected = NodeSet(G.N);
+    const CSR& in = G.in_edges();
+    ws.reset(G.N);
+
+    // Nodes where the effects can meet: u, the nodes that changed and
+    // their successors, which get a different influence
+    VI& Q = ws.frontier;
+    auto add_root = [&](uint v) {
+        ws.touch(v);
+        if (ws.mark[v]) return;
+        ws.mark[v] = true;
+        Q.push_back(v);
+        affected.insert(v);
+    };
+    auto add_changed = [&](uint v) {
+        add_root(v);
+        for (int k = G.adjacency.offset[v]; k < G.adjacency.offset[v+1]; ++k)
+            add_root(G.adjacency.target[k]);
+    };
+    add_changed(u);
+    vector<uint> changed;
+    influenced.symmetric_difference(previous, changed);
+    for (uint v : changed) add_changed(v);
+    uint num_roots = Q.size();
+
+    // Flips that add influence, through nodes outside the spread
+    for (uint head = 0; head < Q.size() and affected.size() <= max_size; ++head) {
+        int v = Q[head];
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (influenced.contains(p)) continue;
+            ws.touch(p);
+            if (not ws.mark[p]) {
+                ws.mark[p] = true;
+                Q.push_back(p);
+                affected.insert(p);
+            }
+        }
+    }
+
+    // Flips that remove influence. The first step from a root takes any
+    // influenced in-neighbour, as the root may change in the other spread
+    VI& R = ws.pending;
+    const VI& level = state.last_spread_level;
+    auto add_lost = [&](uint p) {
+        ws.touch(p);
+        if (ws.influenced[p]) return;
+        ws.influenced[p] = true;
+        R.push_back(p);
+        affected.insert(p);
+    };
+    for (uint i = 0; i < num_roots; ++i) {
+        int v = Q[i];
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k)
+            if (influenced.contains(in.target[k])) add_lost(in.target[k]);
+    }
+    for (uint head = 0; head < R.size() and affected.size() <= max_size; ++head) {
+        int v = R[head];
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (influenced.contains(p) and level[p] < level[v]) add_lost(p);
+        }
+    }
+    return affected.size() <= max_size;
+}
+
+uint IncrementalSpread::influenced_targets_without(uint u, SpreadWorkspace& ws) const {
+    if (not seeds.contains(u)) return num_influenced_targets;
+
+    ws.reset(G.N);
+    const CSR& in = G.in_edges();
+    const CSR& out = G.adjacency;
+    VI& heap = ws.frontier;
+    VI& lost = ws.pending;
+    auto lost_node = [&](uint p) { return ws.valid(p) and ws.mark[p]; };
+
+    // Queues the non seed nodes that got influenced after v, since
+    // only those may have used the influence of v
+    auto queue_successors = [&](uint v) {
+        for (int k = out.offset[v]; k < out.offset[v+1]; ++k) {
+            uint w = out.target[k];
+            if (not influenced.contains(w) or seeds.contains(w)) continue;
+            ws.touch(w);
+            if (not ws.influenced[w] and order[w] > order[v]) {
+                ws.influenced[w] = true;
+                heap.push_back(order[w]);
+                push_heap(heap.begin(), heap.end(), greater<int>());
+            }
+        }
+    };
+
+    ws.touch(u);
+    ws.influenced[u] = true;
+    ws.mark[u] = true;
+    lost.push_back(u);
+    queue_successors(u);
+
+    // First pass, in activation order: a node keeps its influence if the
+    // nodes influenced before it that are still influenced reach its
+    // threshold. As in the spread, a node with none of them is not
+    // influenced, even if its threshold is not positive
+    while (not heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), greater<int>());
+        uint v = state.frontier[heap.back()];
+        heap.pop_back();
+
+        int64_t influence = 0;
+        int count = 0;
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (influenced.contains(p) and order[p] < order[v] and not lost_node(p)) {
+                influence += G.in_contribution[k];
+                ++count;
+            }
+        }
+        if (count == 0 or not reaches_threshold(v, influence, count)) {
+            ws.mark[v] = true;
+            lost.push_back(v);
+            queue_successors(v);
+        }
+    }
+
+    // Second pass: the lost nodes can still be influenced by any of the
+    // remaining ones, or by the ones recovered during this pass
+    VI& Q = ws.frontier;
+    for (uint v : lost) ws.influenced[v] = false;
+    for (uint v : lost) {
+        // The same rounded contributions as the spread, so the sum does
+        // not depend on adding them in the order of the predecessors
+        bool reached = false;
+        for (int k = in.offset[v]; k < in.offset[v+1]; ++k) {
+            uint p = in.target[k];
+            if (influenced.contains(p) and not lost_node(p)) {
+                add_influence(v, G.in_contribution[k], ws);
+                reached = true;
+            }
+        }
+        if (reached and reaches_threshold(v, ws.influence[v], ws.count[v])) {
+            ws.influenced[v] = true;
+            Q.push_back(v);
+        }
+    }
+    for (uint head = 0; head < Q.size(); ++head) {
+        int v = Q[head];
+        for (int k = out.offset[v]; k < out.offset[v+1]; ++k) {
+            uint w = out.target[k];
+            if (not lost_node(w) or ws.influenced[w]) continue;
+            add_influence(w, G.contribution[k], ws);
+            if (reaches_threshold(w, ws.influence[w], ws.count[w])) {
+                ws.influenced[w] = true;
+                Q.push_back(w);
+            }
+        }
+    }
+
+    uint lost_targets = 0;
+    for (uint v : lost)
+        if (not ws.influenced[v] and targets.contains(v))
+            ++lost_targets;
+    return num_influenced_targets - lost_targets;
+}
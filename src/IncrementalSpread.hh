@@ -0,0 +1,167 @@
+/**
+ * @file IncrementalSpread.hh
+ * @author Jaya García
+ * @brief Header of the IncrementalSpread class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef INCREMENTAL_SPREAD_HH
+# define INCREMENTAL_SPREAD_HH
+
+# include "Graph.hh"
+
+/** @class IncrementalSpread
+ * @brief Spread of a seed set that answers single seed flips
+ *
+ * Keeps the activation state of the spread of a seed set, and
+ * computes the number of influenced targets when a single node is
+ * added to or removed from the seeds without spreading from scratch.
+ * Adding a node only propagates forward from it. Removing a seed
+ * revisits, in activation order, the influenced nodes that may have
+ * depended on it, and repairs the ones that lost their support.
+ *
+ * The queries do not modify the object, so several threads can run
+ * them at the same time as long as each one uses its own workspace.
+ *
+ */
+class IncrementalSpread {
+
+public:
+
+    /**
+     * @brief Construct a new Incremental Spread object
+     *
+     * @param H network
+     * @param ths thresholds of the nodes, read at every query
+     */
+    IncrementalSpread(const Graph& H, const Thresholds& ths);
+
+    /**
+     * @brief Computes the spread of a seed set from scratch
+     *
+     * @param initial seed set
+     * @param target target set
+     */
+    void build(const NodeSet& initial, const NodeSet& target);
+
+    /**
+     * @brief Number of influenced target nodes of the current seed set
+     *
+     * @return uint number of targets
+     */
+    uint influenced_targets() const { return num_influenced_targets; }
+
+    /**
+     * @brief Number of influenced target nodes if a node is added to the seeds
+     *
+     * @param u node
+     * @param ws workspace of the calling thread
+     * @return uint number of targets
+     */
+    uint influenced_targets_with(uint u, SpreadWorkspace& ws) const;
+
+    /**
+     * @brief Number of influenced target nodes if a node is removed from the seeds
+     *
+     * @param u node
+     * @param ws workspace of the calling thread
+     * @return uint number of targets
+     */
+    uint influenced_targets_without(uint u, SpreadWorkspace& ws) const;
+
+    /**
+     * @brief Finds in one pass the nodes whose flip may change the
+     * number of influenced targets
+     * 
+     * A node outside the spread is pivotal if it reaches a target that
+     * is not influenced through nodes outside the spread, and a seed is
+     * pivotal if an influenced target depends on it through nodes of
+     * increasing activation level. Flipping any other node leaves the
+     * influenced targets as they are.
+     *
+     * @param pivotal set of pivotal nodes
+     * @param ws workspace of the calling thread
+     */
+    void pivotal_players(NodeSet& pivotal, SpreadWorkspace& ws) const;
+
+    /**
+     * @brief Finds the nodes whose flip may have a different effect on
+     * the spread after a move of u, which took it from previous to the
+     * current one
+     * 
+     * The effect of a flip of v only changes if it meets the effect of
+     * the move: at u, at a node that changed or at a successor of one.
+     * The flip of v reaches those nodes backwards through nodes outside
+     * the spread if it adds influence, or through influenced nodes of
+     * decreasing activation level if it removes influence. The search
+     * uses the spread after the move, and has to be called after build.
+     *
+     * It finds the nodes whose flip reaches other nodes than before. A
+     * best response that depends on the number of influenced targets as
+     * a whole, as in the threshold game, may also change anywhere when
+     * the move changes that number.
+     *
+     * @param u node that moved
+     * @param previous influenced nodes before the move
+     * @param affected set of affected nodes, u and the changed ones included
+     * @param max_size the search gives up after finding more nodes
+     * @param ws workspace of the calling thread
+     * @return false if it gave up, and any node may be affected
+     */
+    bool affected_by(uint u, const NodeSet& previous, NodeSet& affected, uint max_size, SpreadWorkspace& ws) const;
+
+    /** @brief Current seed set */
+    NodeSet seeds;
+
+    /** @brief Influenced nodes of the current seed set */
+    NodeSet influenced;
+
+private:
+
+    /** @brief Instance of the network */
+    const Graph& G;
+
+    /** @brief Thresholds of the game that owns the spread */
+    const Thresholds& T;
+
+    /** @brief Target set */
+    NodeSet targets;
+
+    /** @brief Number of influenced target nodes */
+    uint num_influenced_targets = 0;
+
+    /** @brief Number of target nodes that are seeds or can be influenced */
+    uint num_reachable_targets = 0;
+
+    /** @brief Spread state of the current seed set */
+    SpreadWorkspace state;
+
+    /** @brief Position of every influenced node in the activation order */
+    VI order;
+
+    /**
+     * @brief Whether the influence received by a node reaches its threshold
+     *
+     * @param v node
+     * @param influence received influence, in fixed point units
+     * @param count number of influenced in-neighbours, used instead
+     *              when every edge has weight 1
+     * @return true if v gets influenced
+     */
+    bool reaches_threshold(uint v, int64_t influence, int count) const;
+
+    /**
+     * @brief Adds the influence of an edge to its target in a workspace
+     *
+     * @param v target of the edge
+     * @param c contribution of the edge, in fixed point units
+     * @param ws workspace
+     */
+    void add_influence(uint v, int64_t c, SpreadWorkspace& ws) const;
+};
+
+# endif
@@ -0,0 +1,90 @@
+/**
+ * @file IncrementalSpreadTest.cpp
+ * @author Jaya García
+ * @brief Checks the incremental spread against full spreads
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "IncrementalSpread.hh"
+# include <random>
+
+int failures = 0;
+
+void check(bool ok, string what) {
+    if (ok) return;
+    cout << "FAILED: " << what << endl;
+    ++failures;
+}
+
+// Targets influenced by the seeds without u, with a full spread
+uint spread_without(const Graph& G, const Thresholds& ths, NodeSet seeds, uint u, const NodeSet& targets) {
+    NodeSet influenced(G.N);
+    seeds.erase(u);
+    G.expand_influence(seeds, ths, influenced);
+    return influenced.intersection_size(targets);
+}
+
+// Path 0 -> 1 -> 2 where node 1 has threshold 0: it is influenced only
+// through the seed 0, so removing the seed loses both targets
+void zero_threshold_behind_seed(double weight) {
+    VE edges = {edge(0, 1, weight), edge(1, 2, weight)};
+    Graph G(edges, VD(), VD(), true, 1);
+    Thresholds ths = G.threshold;
+    G.assign_thresholds(ths, VD{1, 0, weight});
+
+    NodeSet seeds(G.N), targets(G.N);
+    seeds.insert(0);
+    targets.insert(1);
+    targets.insert(2);
+    IncrementalSpread spread(G, ths);
+    spread.build(seeds, targets);
+    SpreadWorkspace ws;
+    check(spread.influenced_targets() == 2, "path spread from the seed");
+    check(spread.influenced_targets_without(0, ws) == 0, "path spread without the seed");
+}
+
+// Random graphs with thresholds down to 0, every seed removed in turn
+void random_removals(bool unit, uint num_graphs) {
+    mt19937 gen(unit ? 1 : 2);
+    for (uint g = 0; g < num_graphs; ++g) {
+        uint n = 30;
+        VE edges;
+        for (uint v = 0; v < n; ++v)
+            for (uint u = 0; u < n; ++u)
+                if (u != v and gen() % 8 == 0)
+                    edges.push_back(edge(v, u, unit ? 1 : 0.5 + gen() % 4));
+        if (edges.empty()) continue;
+        Graph G(edges, VD(), VD(), true, 1);
+        Thresholds ths = G.threshold;
+        VD values(G.N);
+        for (uint v = 0; v < G.N; ++v) values[v] = gen() % 3 == 0 ? 0 : gen() % 4;
+        G.assign_thresholds(ths, values);
+
+        NodeSet seeds(G.N), targets(G.N);
+        for (uint v = 0; v < G.N; ++v) {
+            if (gen() % 5 == 0) seeds.insert(v);
+            if (gen() % 2 == 0) targets.insert(v);
+        }
+        IncrementalSpread spread(G, ths);
+        spread.build(seeds, targets);
+        SpreadWorkspace ws;
+        for (uint u = 0; u < G.N; ++u) {
+            if (not seeds.contains(u)) continue;
+            check(spread.influenced_targets_without(u, ws) == spread_without(G, ths, seeds, u, targets),
+                  string(unit ? "unit" : "weighted") + " graph " + to_string(g) + " without " + to_string(u));
+        }
+    }
+}
+
+int main() {
+    zero_threshold_behind_seed(1);
+    zero_threshold_behind_seed(0.5);
+    random_removals(true, 200);
+    random_removals(false, 200);
+    if (failures > 0) return 1;
+    cout << "IncrementalSpread: OK" << endl;
+}
@@ -12,23 +12,25 @@
 # include "InfluenceMaximization.hh"
 # include <algorithm>
 # include <iostream>
+# include <functional>
+# include <sstream>
 
-InfluenceMaximization::InfluenceMaximization(Graph& H) : G(H) {
+InfluenceMaximization::InfluenceMaximization(const Graph& H) : InfluenceMaximization(H, H.threshold) { }
+
+InfluenceMaximization::InfluenceMaximization(const Graph& H, const Thresholds& ths) : G(H), thresholds(ths), target_set(H.N), initial_set(H.N), final_influence(H.N) {
     nodes_type = VT(H.N, PLAYER);
-    generator = std::mt19937(seed);
+    generator = Philox(seed);
 }
 
 void InfluenceMaximization::select_target_set(double proportion) {
     // Selection of target nodes uniformly at random
     num_target = G.N*proportion;
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    
+
     VI nodes(G.N, 0);
     for (uint u = 0; u < G.N; ++u)
         nodes[u] = u;
 
-    std::shuffle(nodes.begin(), nodes.end(), generator);
+    generator.shuffle(nodes);
 
     uint i = 0;
     uint t = 0;
@@ -42,17 +44,15 @@ void InfluenceMaximization::select_target_set(double proportion) {
     }
 }
 
-void InfluenceMaximization::select_target_set(double proportion, std::mt19937& gen) {
+void InfluenceMaximization::select_target_set(double proportion, Philox& gen) {
     // Selection of target nodes uniformly at random
     num_target = G.N*proportion;
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    
+
     VI nodes(G.N, 0);
     for (uint u = 0; u < G.N; ++u)
         nodes[u] = u;
 
-    std::shuffle(nodes.begin(), nodes.end(), gen);
+    gen.shuffle(nodes);
 
     uint i = 0;
     uint t = 0;
@@ -74,9 +74,9 @@ void InfluenceMaximization::select_target_set(VI& target) {
     }
 }
 
-void InfluenceMaximization::select_target_set(USI& target) {
+void InfluenceMaximization::select_target_set(NodeSet& target) {
     num_target = target.size();
-    for (auto& t : target) {
+    for (auto t : target) {
         nodes_type[t] = TARGET;
         target_set.insert(t);
     }
@@ -86,14 +86,11 @@ void InfluenceMaximization::select_initial_set(double proportion) {
     // Selection of initial nodes uniformly at random
     num_initial = G.N*proportion;
 
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    
     VI nodes(G.N);
     for (uint u = 0; u < G.N; ++u)
         nodes[u] = u;
 
-    std::shuffle(nodes.begin(), nodes.end(), generator);
+    generator.shuffle(nodes);
 
     uint i = 0;
     uint t = 0;
@@ -107,18 +104,15 @@ void InfluenceMaximization::select_initial_set(double proportion) {
     }
 }
 
-void InfluenceMaximization::select_initial_set(double proportion, std::mt19937& gen) {
+void InfluenceMaximization::select_initial_set(double proportion, Philox& gen) {
     // Selection of initial nodes uniformly at random
     num_initial = G.N*proportion;
 
-    // uniformly random number generator using mersenne twister engine
-    std::random_device rd;
-    
     VI nodes(G.N);
     for (uint u = 0; u < G.N; ++u)
         nodes[u] = u;
 
-    std::shuffle(nodes.begin(), nodes.end(), gen);
+    gen.shuffle(nodes);
 
     uint i = 0;
     uint t = 0;
@@ -140,18 +134,227 @@ void InfluenceMaximization::select_initial_set(VI& initial) {
     }
 }
 
-void InfluenceMaximization::select_initial_set(USI& initial) {
+void InfluenceMaximization::select_initial_set(NodeSet& initial) {
     num_initial = initial.size();
-    for (auto& i : initial) {
+    for (auto i : initial) {
         nodes_type[i] = INITIAL;
         initial_set.insert(i);
     }
 }
 
+PlayerQueue::PlayerQueue(const VI& players, uint N) : players(players), position(N, -1), queued(players.size(), true) {
+    for (uint i = 0; i < players.size(); ++i) position[players[i]] = i;
+    num_queued = players.size();
+    sweep_next = true;
+}
+
+bool PlayerQueue::pop(int& u) {
+    while (true) {
+        // Positions already passed by a sweep are not in the round anymore
+        while (not current.empty() and current.front() <= cursor) {
+            pop_heap(current.begin(), current.end(), greater<int>());
+            current.pop_back();
+        }
+        int i = -1;
+        if (sweep_current) {
+            if (cursor + 1 < int(players.size())) i = cursor + 1;
+        }
+        else if (not current.empty()) i = current.front();
+
+        if (i >= 0) {
+            cursor = i;
+            // In a sweep of the next round the player stays queued
+            if (not sweep_next) {
+                queued[i] = false;
+                --num_queued;
+            }
+            u = players[i];
+            return true;
+        }
+
+        // Next round
+        if (not sweep_next and next.empty()) return false;
+        sweep_current = sweep_next;
+        sweep_next = false;
+        if (sweep_current) next.clear();
+        swap(current, next);
+        make_heap(current.begin(), current.end(), greater<int>());
+        cursor = -1;
+        ++current_round;
+    }
+}
+
+void PlayerQueue::push(int u) {
+    int i = position[u];
+    if (i < 0 or queued[i]) return;
+    queued[i] = true;
+    ++num_queued;
+    if (i > cursor) {
+        current.push_back(i);
+        push_heap(current.begin(), current.end(), greater<int>());
+    }
+    else next.push_back(i);
+}
+
+void PlayerQueue::push_all() {
+    if (sweep_current and sweep_next) return;
+    fill(queued.begin(), queued.end(), true);
+    num_queued = players.size();
+    sweep_current = sweep_next = true;
+}
+
+void PlayerQueue::save(Checkpoint& c) const {
+    c.header.round = current_round;
+    c.header.num_queued = num_queued;
+    c.header.cursor = cursor;
+    c.header.sweeps = (sweep_current ? 1 : 0) | (sweep_next ? 2 : 0);
+    c.queued = queued;
+    c.current = current;
+    c.next = next;
+}
+
+void PlayerQueue::restore(const Checkpoint& c) {
+    current_round = c.header.round;
+    num_queued = c.header.num_queued;
+    cursor = c.header.cursor;
+    sweep_current = c.header.sweeps & 1;
+    sweep_next = c.header.sweeps & 2;
+    queued.assign(c.queued.begin(), c.queued.begin() + players.size());
+    current = c.current;
+    next = c.next;
+}
+
 void gather_statistics() {
     // This method is to be reimplemented in the subclasses
 }
 
+// SplitMix64 finalizer, every bit of x affects every bit of the result
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t InfluenceMaximization::zobrist_key(uint u, int strategy) const {
+    if (strategy == 0) return 0;
+    return mix(mix(seed) ^ (uint64_t(u) << 32 | uint32_t(strategy)));
+}
+
+void InfluenceMaximization::start_dynamics() {
+    visited.clear();
+    start_time = last_checkpoint = chrono::steady_clock::now();
+}
+
+bool InfluenceMaximization::out_of_budget(uint round) const {
+    if (max_rounds > 0 and round > max_rounds) return true;
+    if (max_seconds <= 0) return false;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+    return elapsed.count() > max_seconds;
+}
+
+uint InfluenceMaximization::repeated_state(int u, uint step) {
+    // The mover is hashed with a strategy no agent plays
+    uint64_t state = profile_hash ^ zobrist_key(u + 1, -1);
+    auto it = visited.emplace(state, step);
+    return it.second ? 0 : step - it.first->second;
+}
+
+bool InfluenceMaximization::checkpoint_due() const {
+    if (checkpoint_path.empty()) return false;
+    chrono::duration<double> since = chrono::steady_clock::now() - last_checkpoint;
+    return since.count() >= checkpoint_seconds;
+}
+
+void InfluenceMaximization::write_checkpoint(uint kind, const VI& strategy, uint round, uint last_round, uint num_moves, const PlayerQueue* queue) {
+    Checkpoint c;
+    if (queue) queue->save(c);
+    c.header.kind = kind;
+    c.header.dynamics = dynamics;
+    c.header.conflict_rule = conflict_rule;
+    c.header.seed = seed;
+    c.header.profile_hash = profile_hash;
+    c.header.round = round;
+    c.header.last_round = last_round;
+    c.header.num_moves = num_moves;
+    last_checkpoint = chrono::steady_clock::now();
+    c.header.elapsed = chrono::duration<double>(last_checkpoint - start_time).count();
+
+    c.nodes_type.assign(nodes_type.begin(), nodes_type.end());
+    c.strategy = strategy;
+    c.threshold = thresholds.value;
+    for (auto& s: visited) {
+        c.visited_states.push_back(s.first);
+        c.visited_steps.push_back(s.second);
+    }
+    ostringstream state;
+    state << generator;
+    c.generator = state.str();
+    c.write(checkpoint_path);
+}
+
+bool InfluenceMaximization::read_checkpoint(uint kind, Checkpoint& c) {
+    if (checkpoint_path.empty()) return false;
+    // A checkpoint of another run must not feed the results of this one
+    if (not resume or not c.read(checkpoint_path) or not same_run(kind, c)) {
+        remove_checkpoint();
+        return false;
+    }
+    visited.clear();
+    for (uint i = 0; i < c.visited_states.size(); ++i)
+        visited.emplace(c.visited_states[i], c.visited_steps[i]);
+    istringstream state(c.generator);
+    state >> generator;
+    last_checkpoint = chrono::steady_clock::now();
+    start_time = last_checkpoint - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(c.header.elapsed));
+    return true;
+}
+
+bool InfluenceMaximization::same_run(uint kind, const Checkpoint& c) const {
+    const CheckpointHeader& h = c.header;
+    if (h.kind != kind or h.dynamics != dynamics or h.conflict_rule != conflict_rule) return false;
+    if (h.N != G.N or h.seed != seed) return false;
+    if (not equal(nodes_type.begin(), nodes_type.end(), c.nodes_type.begin())) return false;
+    Philox subsets;
+    istringstream state(c.generator);
+    if (not (state >> subsets) or not subsets.same_stream(generator)) return false;
+    // A strategy out of sync with the hash means a damaged file
+    uint64_t hash = 0;
+    for (uint u = 0; u < G.N; ++u)
+        if (c.strategy[u] > 0) hash ^= zobrist_key(u, c.strategy[u]);
+    return hash == h.profile_hash;
+}
+
+void InfluenceMaximization::remove_checkpoint() const {
+    if (not checkpoint_path.empty()) remove(checkpoint_path.c_str());
+}
+
+VI InfluenceMaximization::player_nodes() const {
+    VI players;
+    for (uint v = 0; v < G.N; ++v)
+        if (nodes_type[v] == PLAYER)
+            players.push_back(v);
+    return players;
+}
+
+VI InfluenceMaximization::independent_subset(const VI& agents) {
+    VI order = agents;
+    generator.shuffle(order);
+    const CSR& in = G.in_edges();
+    NodeSet blocked(G.N);
+    VI subset;
+    for (int u: order) {
+        if (blocked.contains(u)) continue;
+        subset.push_back(u);
+        for (int k = G.adjacency.offset[u]; k < G.adjacency.offset[u+1]; ++k)
+            blocked.insert(G.adjacency.target[k]);
+        for (int k = in.offset[u]; k < in.offset[u+1]; ++k)
+            blocked.insert(in.target[k]);
+    }
+    sort(subset.begin(), subset.end());
+    return subset;
+}
+
 void InfluenceMaximization::print(const VI& v) const {
     if (v.empty()) cout << "Empty set!";
     else
@@ -182,10 +385,10 @@ void InfluenceMaximization::print(const VD& d) const {
     cout << endl;
 }
 
-void InfluenceMaximization::print(const USI& us) const {
-    if (us.empty()) cout << "Empty set!";
+void InfluenceMaximization::print(const NodeSet& ns) const {
+    if (ns.empty()) cout << "Empty set!";
     else 
-        for (auto& i: us)
+        for (auto i: ns)
             cout << i << " ";
     cout << endl;
 }
@@ -13,7 +13,9 @@
 # define INFLUENCE_MAXIMIZATION_HH
 
 # include "Graph.hh"
+# include "Checkpoint.hh"
 # include <random>
+# include <chrono>
 
 /**
  * @brief Type enumeratio
@@ -22,12 +24,165 @@
  * Target, Initial and Player nodes.
  * 
  */
-enum Type {
+enum Type : uint8_t {
     TARGET, INITIAL, PLAYER
 };
 
 typedef vector<Type> VT;
 
+/**
+ * @brief Order in which the agents play their best responses
+ * 
+ * In SEQUENTIAL dynamics the agents move one after the other and each
+ * one sees the moves of the previous ones. In JACOBI dynamics all the
+ * agents evaluate their best response at the same time against the
+ * profile of the previous round, and the improving moves are then
+ * committed following a ConflictRule.
+ * 
+ */
+enum Dynamics : uint8_t {
+    SEQUENTIAL, JACOBI
+};
+
+/**
+ * @brief How the improving moves of a Jacobi round are committed
+ * 
+ * SINGLE_MOVER commits the first improving agent only. INDEPENDENT_SET
+ * commits at once a random set of improving agents with no edges
+ * between them, and falls back to a single mover if the joint move does
+ * not decrease the potential of the seed game. The threshold game has no
+ * potential, so it does not support INDEPENDENT_SET and plays it as
+ * SINGLE_MOVER. SPECULATIVE commits the improving agents in order,
+ * re-evaluating each one against the moves already committed.
+ * 
+ */
+enum ConflictRule : uint8_t {
+    SINGLE_MOVER, INDEPENDENT_SET, SPECULATIVE
+};
+
+/**
+ * @brief How the dynamics of a game ended
+ * 
+ * CONVERGED when no agent improves, CYCLE when the dynamics come back
+ * to a state they already visited, so they would repeat the same moves
+ * forever, and BUDGET when the rounds or the time allowed run out first.
+ * 
+ */
+enum Termination : uint8_t {
+    CONVERGED, CYCLE, BUDGET
+};
+
+/** @struct DynamicsOutcome
+ * @brief Result of game_dynamics
+ * 
+ */
+struct DynamicsOutcome {
+
+    /** @brief How the dynamics ended */
+    Termination termination = CONVERGED;
+
+    /** @brief Number of rounds played */
+    uint rounds = 0;
+
+    /** @brief Number of profiles in the cycle, 0 if no cycle was found */
+    uint cycle_length = 0;
+};
+
+/** @class PlayerQueue
+ * @brief Players whose best response may have changed, visited in the
+ * order of the sweeps of the sequential dynamics
+ * 
+ * The players are visited in rounds, by increasing position. A player
+ * queued while its position in the current round is still ahead is
+ * visited in this round, otherwise in the next one, as a full sweep
+ * would do. The rounds are then numbered as the ones of the sweeps.
+ * When every player has to be queued, the rest of the round and the
+ * next one become full sweeps without queueing them one by one.
+ * 
+ */
+class PlayerQueue {
+
+public:
+
+    /**
+     * @brief Construct a new Player Queue object with every player queued
+     * 
+     * @param players player nodes, in the order of the sweeps
+     * @param N number of nodes
+     */
+    PlayerQueue(const VI& players, uint N);
+
+    /**
+     * @brief Takes the next player, starting a new round when the
+     * current one is over
+     * 
+     * @param u next player
+     * @return false if no player is queued
+     */
+    bool pop(int& u);
+
+    /**
+     * @brief Queues a player again, nothing if it already is or if u
+     * is not a player
+     * 
+     * @param u node
+     */
+    void push(int u);
+
+    /**
+     * @brief Queues every player again
+     * 
+     */
+    void push_all();
+
+    /** @brief Number of players that are not queued */
+    uint num_clean() const { return players.size() - num_queued; }
+
+    /** @brief Round of the last player taken, starting at 1 */
+    uint round() const { return current_round; }
+
+    /**
+     * @brief Stores the players queued and the round in a checkpoint
+     * 
+     * @param c checkpoint
+     */
+    void save(Checkpoint& c) const;
+
+    /**
+     * @brief Restores the players queued and the round from a checkpoint
+     * of a queue with the same players
+     * 
+     * @param c checkpoint
+     */
+    void restore(const Checkpoint& c);
+
+private:
+
+    VI players;
+
+    /** @brief Position of every node in players, -1 for other nodes */
+    VI position;
+
+    vector<char> queued;
+
+    /** @brief Positions still to visit in this round, as a min-heap */
+    VI current;
+
+    /** @brief Positions to visit in the next round */
+    VI next;
+
+    /** @brief Number of players queued, counting the ones of the sweeps */
+    uint num_queued = 0;
+
+    /** @brief Whether every position after the cursor is visited in
+     * this round, and every position in the next one */
+    bool sweep_current = false;
+    bool sweep_next = false;
+
+    int cursor = -1;
+    uint current_round = 0;
+};
+
 /** @class InfluenceMaximization
  * @brief Placeholder for the Target Set Influence Games.
  * 
@@ -42,8 +197,12 @@ class InfluenceMaximization {
 
 public:
 
-    /** @brief Instance of the network */
-    Graph& G;
+    /** @brief Instance of the network, shared with other games */
+    const Graph& G;
+
+    /** @brief Thresholds of the nodes in this game, every spread of
+     * the game reads them instead of the base ones of the network */
+    Thresholds thresholds;
 
     /** @brief array with the type of the nodes: Initial, Target or Player */
     VT nodes_type;
@@ -55,26 +214,66 @@ public:
     uint num_initial;
 
     /** @brief Target set */
-    USI target_set;
+    NodeSet target_set;
 
     /** @brief Initial set */
-    USI initial_set;
+    NodeSet initial_set;
 
     /** @brief Influenced nodes */
-    USI final_influence;
+    NodeSet final_influence;
+
+    /** @brief Reusable state for the spreads of the game */
+    SpreadWorkspace workspace;
 
     /** @brief Seed value */
     unsigned seed = 2000;
 
     /** @brief Random Number Generator */
-    std::mt19937 generator;
+    Philox generator;
+
+    /** @brief Dynamics played by game_dynamics */
+    Dynamics dynamics = SEQUENTIAL;
+
+    /** @brief Rule to commit the moves of the Jacobi dynamics */
+    ConflictRule conflict_rule = SPECULATIVE;
+
+    /** @brief Maximum number of rounds of game_dynamics, 0 for no limit */
+    uint max_rounds = 0;
+
+    /** @brief Maximum wall time of game_dynamics in seconds, 0 for no limit */
+    double max_seconds = 0;
+
+    /** @brief File where game_dynamics keeps its checkpoints, none if
+     * empty. It is removed once the dynamics converge or cycle */
+    string checkpoint_path;
+
+    /** @brief Whether game_dynamics goes on from the checkpoint of
+     * checkpoint_path when it holds one of the same game and rules.
+     * Otherwise any checkpoint left there is removed */
+    bool resume = false;
+
+    /** @brief Seconds between two checkpoints */
+    double checkpoint_seconds = 600;
+
+    /** @brief Zobrist hash of the strategy profile, the XOR of the keys
+     * of the strategies of every agent. The games keep it up to date on
+     * every change of strategy */
+    uint64_t profile_hash = 0;
 
     /**
      * @brief Construct a new Influence Maximization object
      * 
      * @param H input graph 
      */
-    InfluenceMaximization(Graph& H);
+    InfluenceMaximization(const Graph& H);
+
+    /**
+     * @brief Construct a new Influence Maximization object
+     * 
+     * @param H input graph
+     * @param ths thresholds the game starts from
+     */
+    InfluenceMaximization(const Graph& H, const Thresholds& ths);
 
     /**
      * @brief Randomly initializes a target set
@@ -89,7 +288,7 @@ public:
      * @param proportion proportion of nodes in the target set
      * @param gen random number generator instance
      */
-    void select_target_set(double proportion, std::mt19937& gen);
+    void select_target_set(double proportion, Philox& gen);
 
     /**
      * @brief Initializes the target set from a list of nodes
@@ -101,9 +300,9 @@ public:
     /**
      * @brief Initializes the target set from a set of nodes
      * 
-     * @param target set of nodes in an unordered map
+     * @param target set of nodes
      */
-    void select_target_set(USI& target);
+    void select_target_set(NodeSet& target);
 
     /**
      * @brief Randomly initializes the initial set
@@ -118,7 +317,7 @@ public:
      * @param proportion proportion of nodes in the initial set
      * @param gen random number generator instance
      */
-    void select_initial_set(double proportion, std::mt19937& gen);
+    void select_initial_set(double proportion, Philox& gen);
 
     /**
      * @brief Initializes the target set from a set of nodes
@@ -130,9 +329,126 @@ public:
     /**
      * @brief Initializes the target set from a set of nodes
      * 
-     * @param initial set of nodes in an unordered map
+     * @param initial set of nodes
+     */
+    void select_initial_set(NodeSet& initial);
+
+    /**
+     * @brief Agents that play the game, in increasing order
+     * 
+     * @return VI player nodes
+     */
+    VI player_nodes() const;
+
+    /**
+     * @brief Random maximal subset of agents with no edges between them
+     * 
+     * @param agents candidate agents
+     * @return VI subset in increasing order
+     */
+    VI independent_subset(const VI& agents);
+
+    /**
+     * @brief Key of an agent playing a strategy in the profile hash
+     * 
+     * The keys are drawn from the seed of the game by a mixing function
+     * instead of a table, as the thresholds go up to the in-degree. The
+     * strategy 0 has key 0, so the empty profile has hash 0.
+     * 
+     * @param u node
+     * @param strategy strategy of u
+     * @return uint64_t key
+     */
+    uint64_t zobrist_key(uint u, int strategy) const;
+
+    /**
+     * @brief Updates the profile hash when an agent changes its strategy
+     * 
+     * @param u node
+     * @param old_strategy strategy u leaves
+     * @param new_strategy strategy u plays
+     */
+    void update_hash(uint u, int old_strategy, int new_strategy) {
+        profile_hash ^= zobrist_key(u, old_strategy) ^ zobrist_key(u, new_strategy);
+    }
+
+    /**
+     * @brief Starts the clock of the time budget and forgets the
+     * states visited by previous dynamics
+     * 
+     */
+    void start_dynamics();
+
+    /**
+     * @brief Whether a round can no longer be played within the budget
+     * 
+     * @param round round about to be played, starting at 1
+     * @return true if the rounds or the time allowed are over
+     */
+    bool out_of_budget(uint round) const;
+
+    /**
+     * @brief Records the state of the dynamics after a step
+     * 
+     * The state is the current profile after the move of u, or between
+     * rounds if u is -1. Two states share a hash only by collision, with
+     * a probability of 2^-64 per pair.
+     * 
+     * @param u agent that just moved, -1 at the end of a round
+     * @param step number of steps recorded so far, counting this one
+     * @return uint steps since the state was first visited, 0 if new
+     */
+    uint repeated_state(int u, uint step);
+
+    /**
+     * @brief Whether the dynamics have to write a checkpoint
+     * 
+     * @return true if checkpoint_seconds passed since the last one
+     */
+    bool checkpoint_due() const;
+
+    /**
+     * @brief Writes a checkpoint of the dynamics to checkpoint_path, with
+     * the thresholds, the states visited, the time spent and the generator
+     * 
+     * @param kind game, see CheckpointHeader::kind
+     * @param strategy strategy of every node, -1 if it has none
+     * @param round rounds started
+     * @param last_round last round where an agent moved
+     * @param num_moves moves recorded by the cycle detection
+     * @param queue players queued in the sequential dynamics, if any
+     */
+    void write_checkpoint(uint kind, const VI& strategy, uint round, uint last_round, uint num_moves, const PlayerQueue* queue = nullptr);
+
+    /**
+     * @brief Reads the checkpoint of checkpoint_path if resume is set and
+     * it comes from the same game, with the same rules and stream of
+     * random subsets, and restores the states visited, the time spent
+     * and the generator. The game restores its profile and thresholds
+     * from it. A checkpoint that is not resumed is removed
+     * 
+     * @param kind game, see CheckpointHeader::kind
+     * @param c checkpoint read
+     * @return true if the dynamics resume from the checkpoint
+     */
+    bool read_checkpoint(uint kind, Checkpoint& c);
+
+    /**
+     * @brief Whether a checkpoint comes from this game with the same
+     * rules and stream of random subsets. The budget may differ, so that
+     * a game out of budget can go on with a larger one
+     *
+     * @param kind game, see CheckpointHeader::kind
+     * @param c checkpoint read
+     * @return true if the dynamics can resume from it
      */
-    void select_initial_set(USI& initial);
+    bool same_run(uint kind, const Checkpoint& c) const;
+
+    /**
+     * @brief Removes the checkpoint of the dynamics, if any
+     * 
+     */
+    void remove_checkpoint() const;
 
     /**
      * @brief Method to compute the metrics from the sets
@@ -165,11 +481,11 @@ public:
     void print(const VD& d) const;
 
     /**
-     * @brief Prints a given unordered set of ints
+     * @brief Prints a given set of nodes
      * 
-     * @param us unordered set
+     * @param ns node set
      */
-    void print(const USI& us) const;
+    void print(const NodeSet& ns) const;
 
     /**
      * @brief Prints a given unorderd map of int to int
@@ -183,6 +499,17 @@ public:
      * 
      */
     void print_target_set() const;
+
+private:
+
+    /** @brief Step at which each state of the dynamics was first visited */
+    unordered_map<uint64_t, uint> visited;
+
+    /** @brief Start of the current dynamics */
+    chrono::steady_clock::time_point start_time;
+
+    /** @brief Time of the last checkpoint written or read */
+    chrono::steady_clock::time_point last_checkpoint;
 };
 
 # endif
\ No newline at end of file
@@ -12,23 +12,20 @@
 # include "InitialSetSelection.hh"
 # include <iostream>
 # include <algorithm>
-# include <omp.h>
+# include "ThreadPool.hh"
 
-InitialSetSelection::InitialSetSelection(Graph& H) : InfluenceMaximization(H) {
+InitialSetSelection::InitialSetSelection(const Graph& H) : InitialSetSelection(H, H.threshold) { }
+
+InitialSetSelection::InitialSetSelection(const Graph& H, const Thresholds& ths) : InfluenceMaximization(H, ths), strategy_profile(H.N, 0), participating(H.N), spread(H, thresholds) {
     // Initialize graph
     NP = G.N - num_target;  // #players = |V| - |T|
 }
 
-void InitialSetSelection::select_initial_configuration(USI& set) {
+void InitialSetSelection::select_initial_configuration(NodeSet& set) {
     NP = G.N - target_set.size();
     for (uint u = 0; u < G.N; ++u) {
         if (nodes_type[u] != TARGET) {
-            if (set.find(u) != set.end()) {
-                strategy_profile[u] = 1;
-            }
-            else {
-                strategy_profile[u] = 0;
-            }
+            set_strategy(u, set.contains(u));
         }
     }
 }
@@ -38,15 +35,14 @@ void InitialSetSelection::select_initial_configuration(string mode) {
     if (mode == "empty") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile[u] = 0;
+                set_strategy(u, 0);
     }
     else if (mode == "complete") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile[u] = 1;
+                set_strategy(u, 1);
     }
     else if (mode == "random") {
-        std::random_device rd;
         std::uniform_int_distribution<int> distribution(1, NP);
         int num_participants = distribution(generator);
         
@@ -54,35 +50,34 @@ void InitialSetSelection::select_initial_configuration(string mode) {
         for (uint u = 0; u < G.N; ++u)
             nodes[u] = u;
         
-        std::shuffle(nodes.begin(), nodes.end(), generator);
+        generator.shuffle(nodes);
 
         uint p = 0;
         for (uint u = 0; u < G.N; ++u) {
             if (nodes_type[u] != TARGET) {
                 if (p < num_participants)
-                    strategy_profile[u] = 1;
+                    set_strategy(u, 1);
                 else
-                    strategy_profile[u] = 0;
+                    set_strategy(u, 0);
                 ++p;
             }
         }
     }
 }
 
-void InitialSetSelection::select_initial_configuration(string mode, std::mt19937& gen) {
+void InitialSetSelection::select_initial_configuration(string mode, Philox& gen) {
     NP = G.N - target_set.size();
     if (mode == "empty") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile[u] = 0;
+                set_strategy(u, 0);
     }
     else if (mode == "complete") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile[u] = 1;
+                set_strategy(u, 1);
     }
     else if (mode == "random") {
-        std::random_device rd;
         std::uniform_int_distribution<int> distribution(1, NP);
         int num_participants = distribution(gen);
         
@@ -90,62 +85,178 @@ void InitialSetSelection::select_initial_configuration(string mode, std::mt19937
         for (uint u = 0; u < G.N; ++u)
             nodes[u] = u;
         
-        std::shuffle(nodes.begin(), nodes.end(), gen);
+        gen.shuffle(nodes);
 
         uint p = 0;
         for (uint u = 0; u < G.N; ++u) {
             if (nodes_type[u] != TARGET) {
                 if (p < num_participants)
-                    strategy_profile[u] = 1;
+                    set_strategy(u, 1);
                 else
-                    strategy_profile[u] = 0;
+                    set_strategy(u, 0);
                 ++p;
             }
         }
     }
 }
 
+void InitialSetSelection::set_strategy(uint u, uint8_t action) {
+    update_hash(u, strategy_profile[u], action);
+    strategy_profile[u] = action;
+    if (action) participating.insert(u);
+    else participating.erase(u);
+}
+
 double InitialSetSelection::compute_cost(int u, int action) {
+    return compute_cost(u, action, workspaces[action]);
+}
+
+double InitialSetSelection::compute_cost(int u, int action, SpreadWorkspace& ws) const {
     // c_u(s) = |T| - |F(I_s) \cap T| + \alpha s_u
-    USI played_set;
-    for (auto& s: strategy_profile)
-        if (s.second)
-            played_set.insert(s.first);
-    if (action) played_set.insert(u);
-    else played_set.erase(u);
-
-    USI influence_expansion;
-    G.expand_influence(played_set, influence_expansion);
-    uint influence_size = G.intersection_size(influence_expansion, target_set);
+    uint influence_size;
+    if (action) influence_size = spread.influenced_targets_with(u, ws);
+    else influence_size = spread.influenced_targets_without(u, ws);
     double cost = num_target - influence_size + alpha*action;
     return cost;
 }
 
+double InitialSetSelection::potential() const {
+    // Every improving move of an agent decreases it by its gain
+    return num_target - spread.influenced_targets() + alpha*participating.size();
+}
+
+void InitialSetSelection::update_spread() {
+    spread.build(participating, target_set);
+    spread.pivotal_players(pivotal, workspaces[0]);
+}
+
 int InitialSetSelection::best_response(int u) {
-    double non_participation_cost;
-    double participation_cost;
+    // Participating only pays off if it changes the influenced targets
+    if (not pivotal.contains(u)) return 0;
 
+    // Both costs are incremental over the current spread, too cheap to
+    // be worth a task of the pool each
     // Try first when the agent does not participate: s_v = 0
-    # pragma omp parallel
-    # pragma omp single
-    {
-        #pragma omp task
-        {
-        non_participation_cost = compute_cost(u, 0);
-        }
+    double non_participation_cost = compute_cost(u, 0);
+
+    // Try second when the agent does participate: s_v = 1
+    double participation_cost = compute_cost(u, 1);
+    return (non_participation_cost < participation_cost) ? 0 : 1;
+}
 
-        // Try second when the agent does participate: s_v = 1
-        #pragma omp task
-        {
-        participation_cost = compute_cost(u, 1);
+int InitialSetSelection::best_response(int u, SpreadWorkspace& ws) const {
+    if (not pivotal.contains(u)) return 0;
+    double non_participation_cost = compute_cost(u, 0, ws);
+    double participation_cost = compute_cost(u, 1, ws);
+    return (non_participation_cost < participation_cost) ? 0 : 1;
+}
+
+DynamicsOutcome InitialSetSelection::sequential_dynamics(const VI& players, const Checkpoint* resume) {
+    PlayerQueue queue(players, G.N);
+    NodeSet previous, affected;
+    uint last_round = 0;
+    uint num_moves = 0;
+    if (resume) {
+        queue.restore(*resume);
+        last_round = resume->header.last_round;
+        num_moves = resume->header.num_moves;
+    }
+    int v;
+    while (true) {
+        if (checkpoint_due())
+            write_checkpoint(0, strategies(), queue.round(), last_round, num_moves, &queue);
+        if (not queue.pop(v)) break;
+        if (out_of_budget(queue.round()))
+            return DynamicsOutcome{BUDGET, queue.round() - 1, 0};
+        int br = best_response(v);
+        // If the strategy profile is different from
+        // the best response then agent can improve
+        if (strategy_profile[v] != br) {
+            previous = spread.influenced;
+            set_strategy(v, br);
+            update_spread();
+            // Only the players not queued yet are worth finding, so
+            // the search stops once there are more than those
+            if (spread.affected_by(v, previous, affected, queue.num_clean(), workspaces[0])) {
+                for (auto w : affected)
+                    if (int(w) != v) queue.push(w);
+            }
+            else queue.push_all();
+            last_round = queue.round();
+            // The sweeps go on from the position of v, so visiting the
+            // same profile after a move of v repeats the moves in between
+            uint length = repeated_state(v, ++num_moves);
+            if (length > 0) return DynamicsOutcome{CYCLE, last_round, length};
         }
     }
-    return (non_participation_cost < participation_cost) ? 0 : 1;
+    // The sweeps end with a round where no agent improves
+    return DynamicsOutcome{CONVERGED, last_round + 1, 0};
 }
 
-uint InitialSetSelection::game_dynamics() {
-    bool some_improved = true;
+DynamicsOutcome InitialSetSelection::jacobi_dynamics(const VI& players, const Checkpoint* resume) {
+    ThreadPool& pool = ThreadPool::instance();
+    uint num_chunks = min<uint>(players.size(), 4*pool.size());
+    round_workspaces.resize(num_chunks);
+    VI response(players.size());
     uint n_rounds = 0;
+    update_spread();
+    // The rounds of INDEPENDENT_SET depend on the random subsets, so a
+    // profile seen before does not make them repeat
+    bool detect_cycles = conflict_rule != INDEPENDENT_SET;
+    if (resume) n_rounds = resume->header.round;
+    else if (detect_cycles) repeated_state(-1, 0);
+    while (true) {
+        if (checkpoint_due()) write_checkpoint(0, strategies(), n_rounds, 0, 0);
+        if (out_of_budget(n_rounds + 1))
+            return DynamicsOutcome{BUDGET, n_rounds, 0};
+        ++n_rounds;
+        // Best responses against the profile of the previous round
+        pool.parallel_for(num_chunks, [&](uint c) {
+            uint first = players.size()*c/num_chunks;
+            uint last = players.size()*(c + 1)/num_chunks;
+            for (uint i = first; i < last; ++i)
+                response[i] = best_response(players[i], round_workspaces[c]);
+        });
+        VI movers;
+        for (uint i = 0; i < players.size(); ++i)
+            if (strategy_profile[players[i]] != response[i])
+                movers.push_back(players[i]);
+        if (movers.empty()) return DynamicsOutcome{CONVERGED, n_rounds, 0};
+        commit_moves(movers);
+        if (not detect_cycles) continue;
+        uint length = repeated_state(-1, n_rounds);
+        if (length > 0) return DynamicsOutcome{CYCLE, n_rounds, length};
+    }
+}
+
+void InitialSetSelection::commit_moves(const VI& movers) {
+    if (conflict_rule == SPECULATIVE) {
+        // Each mover flips only if it still improves after the flips
+        // before it in the round, so every flip decreases the potential
+        for (int u: movers) {
+            if (strategy_profile[u] != best_response(u, workspaces[0])) {
+                set_strategy(u, 1 - strategy_profile[u]);
+                update_spread();
+            }
+        }
+        return;
+    }
+    if (conflict_rule == INDEPENDENT_SET and movers.size() > 1) {
+        // The joint move is kept if it decreases the potential, as
+        // single improving moves do, so the dynamics still converge
+        double before = potential();
+        VI subset = independent_subset(movers);
+        for (int u: subset) set_strategy(u, 1 - strategy_profile[u]);
+        update_spread();
+        if (potential() < before) return;
+        for (int u: subset) set_strategy(u, 1 - strategy_profile[u]);
+    }
+    set_strategy(movers[0], 1 - strategy_profile[movers[0]]);
+    update_spread();
+}
+
+DynamicsOutcome InitialSetSelection::game_dynamics() {
+    DynamicsOutcome outcome;
     VI player_nodes = VI(NP, 0);
     uint index = 0;
     for (uint v = 0; v < G.N; ++v) {
@@ -155,42 +266,39 @@ uint InitialSetSelection::game_dynamics() {
         }
     }
 
-    while (some_improved) {
-        some_improved = false;
-        // cout << "Round: " << n_rounds << endl;
-        for (auto& v : player_nodes) {
-            
-            // print_profile();
-            int br = best_response(v);
-            // If the strategy profile is different from
-            // the best response then agent can 
-            if (strategy_profile[v] != br) {
-                strategy_profile[v] = br;
-                some_improved = true;
-            }
-        }
-        ++n_rounds;
-    }
+    start_dynamics();
+    Checkpoint resume;
+    bool resumed = read_checkpoint(0, resume);
+    if (resumed)
+        for (uint u = 0; u < G.N; ++u)
+            if (nodes_type[u] != TARGET) set_strategy(u, resume.strategy[u]);
+    update_spread();
+    if (dynamics == JACOBI)
+        outcome = jacobi_dynamics(player_nodes, resumed ? &resume : nullptr);
+    else
+        outcome = sequential_dynamics(player_nodes, resumed ? &resume : nullptr);
+    // Out of budget, the dynamics can still go on from the checkpoint
+    if (outcome.termination != BUDGET) remove_checkpoint();
     // Update the initial set instance
-    for (auto& s: strategy_profile)
-        if (s.second)
-            initial_set.insert(s.first);
-    G.expand_influence(initial_set, final_influence);
-    return n_rounds;
+    for (auto u: participating)
+        initial_set.insert(u);
+    G.expand_influence_parallel(initial_set, thresholds, final_influence);
+    return outcome;
+}
+
+VI InitialSetSelection::strategies() const {
+    return VI(strategy_profile.begin(), strategy_profile.end());
 }
 
 void InitialSetSelection::print_profile() const {
     cout << "Strategy profile: ";
     print(nodes_type);
     cout << "                  ";
-    VI strategy(G.N, -1);
-    for (auto& s: strategy_profile)
-        strategy[s.first] = s.second;
-    for (auto& i: strategy) {
-        if (i == -1)
+    for (uint u = 0; u < G.N; ++u) {
+        if (nodes_type[u] == TARGET)
             cout << "- ";
         else
-            cout << i << " ";
+            cout << int(strategy_profile[u]) << " ";
     }
     cout << endl;
 }
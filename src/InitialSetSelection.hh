@@ -13,6 +13,7 @@
 # define INITIAL_SET_HH
 
 # include "InfluenceMaximization.hh"
+# include "IncrementalSpread.hh"
 
 /**
  * @brief Class for the Seed Set Selection Game
@@ -23,8 +24,12 @@
 class InitialSetSelection : public InfluenceMaximization {
 
 public:
-    /** @brief Strategy chosen for each agent */
-    UMII strategy_profile;
+    /** @brief Strategy chosen for each agent, 1 if it participates */
+    vector<uint8_t> strategy_profile;
+
+    /** @brief Agents that participate, kept in sync with strategy_profile
+     * by set_strategy. Its size is the number of participants */
+    NodeSet participating;
 
     /** @brief Price paid by the agents in the cost function */
     const double alpha = 0.5;
@@ -32,19 +37,42 @@ public:
     /** @brief Number of Players */
     uint NP;
 
+    /** @brief Spread state of each action evaluated by best_response,
+     * so that both evaluations can run as concurrent tasks of the pool */
+    SpreadWorkspace workspaces[2];
+
+    /** @brief Spread state of each part of the players evaluated in
+     * parallel by the Jacobi dynamics */
+    vector<SpreadWorkspace> round_workspaces;
+
+    /** @brief Spread of the current strategy profile */
+    IncrementalSpread spread;
+
+    /** @brief Agents whose action may change the influenced targets
+     * of the current strategy profile */
+    NodeSet pivotal;
+
     /**
      * @brief Construct a new Initial Set Selection object
      * 
      * @param H network
      */
-    InitialSetSelection(Graph& H);
+    InitialSetSelection(const Graph& H);
+
+    /**
+     * @brief Construct a new Initial Set Selection object
+     * 
+     * @param H network
+     * @param ths thresholds of the nodes
+     */
+    InitialSetSelection(const Graph& H, const Thresholds& ths);
 
     /**
      * @brief Initializes the strategy profile with a given set
      * 
      * @param set nodes that participate
      */
-    void select_initial_configuration(USI& set);
+    void select_initial_configuration(NodeSet& set);
 
     /**
      * @brief Initializes the strategy profile
@@ -62,33 +90,135 @@ public:
      *             "empty" | "complete" | "random"
      * @param gen random number generator
      */
-    void select_initial_configuration(string mode, std::mt19937& gen);
+    void select_initial_configuration(string mode, Philox& gen);
+
+    /**
+     * @brief Changes the strategy of an agent in constant time,
+     * along with the profile hash
+     * 
+     * @param u node
+     * @param action 1 to participate, 0 otherwise
+     */
+    void set_strategy(uint u, uint8_t action);
     
     /**
      * @brief Computes the cost of an agent for a given action
      * in the game
      * 
+     * The cost is evaluated as a change of the action of u over
+     * the spread of the participating set, which has to be
+     * up to date (see update_spread)
+     * 
      * @param u node
      * @param action chosen action
      * @return double cost
      */
     double compute_cost(int u, int action);
 
+    /**
+     * @brief Computes the cost of an agent for a given action
+     * using the spread state of the calling thread
+     * 
+     * @param u node
+     * @param action chosen action
+     * @param ws workspace of the calling thread
+     * @return double cost
+     */
+    double compute_cost(int u, int action, SpreadWorkspace& ws) const;
+
+    /**
+     * @brief Exact potential of the game, the number of targets not
+     * influenced plus alpha times the number of participants
+     * 
+     * @return double potential
+     */
+    double potential() const;
+
+    /**
+     * @brief Recomputes the spread of the current strategy profile
+     * and its pivotal agents
+     * 
+     */
+    void update_spread();
+
     /**
      * @brief Computes the Best Response of an agent in the game
      * 
+     * Agents that are not pivotal do not participate, as
+     * participating would only add alpha to their cost
+     * 
      * @param u node 
      * @return int Best Response strategy
      */
     int best_response(int u);
 
+    /**
+     * @brief Computes the Best Response of an agent in the calling thread
+     * 
+     * @param u node
+     * @param ws workspace of the calling thread
+     * @return int Best Response strategy
+     */
+    int best_response(int u, SpreadWorkspace& ws) const;
+
+    /**
+     * @brief Plays best responses one agent at a time until no agent
+     * improves
+     * 
+     * Only the agents whose best response may have changed since they
+     * were last evaluated are evaluated again (see
+     * IncrementalSpread::affected_by), in the order of full sweeps over
+     * the players. The profiles visited are the ones of the sweeps.
+     * 
+     * Stops at the first profile visited twice after a move of the same
+     * agent, or when the budget runs out.
+     * 
+     * @param players player nodes
+     * @param resume checkpoint the dynamics go on from, if any
+     * @return DynamicsOutcome outcome, with the rounds the sweeps would
+     * have played
+     */
+    DynamicsOutcome sequential_dynamics(const VI& players, const Checkpoint* resume = nullptr);
+
+    /**
+     * @brief Plays Jacobi rounds until no agent improves
+     * 
+     * Stops at the first profile that ends two rounds, or when the
+     * budget runs out. The rounds of INDEPENDENT_SET commit random
+     * subsets of the movers, so a profile seen again is not a cycle and
+     * they go on until no agent improves or the budget runs out.
+     * 
+     * @param players player nodes
+     * @param resume checkpoint the dynamics go on from, if any
+     * @return DynamicsOutcome outcome
+     */
+    DynamicsOutcome jacobi_dynamics(const VI& players, const Checkpoint* resume = nullptr);
+
+    /**
+     * @brief Commits the improving moves of a Jacobi round
+     * following the conflict rule
+     * 
+     * @param movers agents whose best response differs from their strategy
+     */
+    void commit_moves(const VI& movers);
+
     /**
      * @brief Simulates the Best Response Dynamics of the game
      * 
-     * @return uint number of rounds played
+     * Resumes from the checkpoint of checkpoint_path if resume is set and
+     * it holds one of this game, and writes one every checkpoint_seconds.
+     * 
+     * @return DynamicsOutcome how the dynamics ended
      */
-    uint game_dynamics();
+    DynamicsOutcome game_dynamics();
     
+    /**
+     * @brief Strategy of every node, as stored in a checkpoint
+     * 
+     * @return VI strategies
+     */
+    VI strategies() const;
+
     /**
      * @brief Prints the current strategy profile
      * 
@@ -0,0 +1,62 @@
+/**
+ * @file MappedFile.cpp
+ * @author Jaya García
+ * @brief Implementation of the MappedFile class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "MappedFile.hh"
+# include <cstring>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+MappedFile::MappedFile(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    opened = true;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        length = info.st_size;
+        mtime = int64_t(info.st_mtim.tv_sec)*1000000000 + info.st_mtim.tv_nsec;
+    }
+    if (length > 0) {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) length = 0;
+        else {
+            madvise(p, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(p);
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+}
+
+FileStamp MappedFile::stamp() const {
+    FileStamp s;
+    if (not opened) return s;
+    s.size = length;
+    s.mtime = mtime;
+
+    // FNV-1a over 64 bit words, the tail byte by byte
+    const uint64_t PRIME = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        h = (h ^ word)*PRIME;
+    }
+    for (; i < length; ++i) h = (h ^ uint8_t(bytes[i]))*PRIME;
+    s.hash = h;
+    return s;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file MappedFile.hh
+ * @author Jaya García
+ * @brief Header of the MappedFile class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef MAPPED_FILE_HH
+# define MAPPED_FILE_HH
+
+# include <string>
+# include <cstdint>
+# include <cstddef>
+
+using namespace std;
+
+/** @struct FileStamp
+ * @brief Identity of the contents of a file
+ *
+ */
+struct FileStamp {
+
+    /** @brief Size in bytes, 0 if the file does not exist */
+    uint64_t size = 0;
+
+    /** @brief Last modification time in nanoseconds */
+    int64_t mtime = 0;
+
+    /** @brief Hash of the contents */
+    uint64_t hash = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size and mtime == other.mtime and hash == other.hash;
+    }
+    bool operator!=(const FileStamp& other) const { return not (*this == other); }
+};
+
+/** @class MappedFile
+ * @brief Read only memory mapping of a whole file
+ *
+ * The mapping lives as long as the object, so pointers into the
+ * data must not outlive it. A file that cannot be opened, or an
+ * empty one, gives an object with no data.
+ *
+ */
+class MappedFile {
+
+public:
+
+    /**
+     * @brief Maps a file into memory
+     *
+     * @param path path of the file
+     */
+    MappedFile(const string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Whether the file could be opened
+     *
+     * @return true if it exists and is readable
+     */
+    bool is_open() const { return opened; }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    /**
+     * @brief Size, modification time and hash of the mapped file
+     *
+     * @return FileStamp stamp, all zero if the file does not exist
+     */
+    FileStamp stamp() const;
+
+private:
+
+    bool opened = false;
+    const char* bytes = nullptr;
+    size_t length = 0;
+    int64_t mtime = 0;
+};
+
+# endif
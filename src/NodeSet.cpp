@@ -0,0 +1,76 @@
+/**
+ * @file NodeSet.cpp
+ * @author Jaya García
+ * @brief Implementation of the NodeSet class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "NodeSet.hh"
+# include <algorithm>
+
+NodeSet::iterator::iterator(const NodeSet* set, uint word) : set(set), word(word), bits(0) {
+    if (word < set->words.size()) {
+        bits = set->words[word];
+        skip_empty();
+    }
+}
+
+NodeSet::iterator& NodeSet::iterator::operator++() {
+    bits &= bits - 1;
+    skip_empty();
+    return *this;
+}
+
+void NodeSet::iterator::skip_empty() {
+    uint num_words = set->words.size();
+    while (bits == 0 and ++word < num_words)
+        bits = set->words[word];
+    if (bits == 0) word = num_words;
+}
+
+NodeSet::NodeSet() = default;
+
+NodeSet::NodeSet(uint N) : N(N), count(0), words((N + 63) >> 6, 0) {}
+
+void NodeSet::clear() {
+    std::fill(words.begin(), words.end(), 0);
+    count = 0;
+}
+
+void NodeSet::resize(uint N) {
+    if (N == this->N) return;
+    this->N = N;
+    words.resize((N + 63) >> 6, 0);
+    if (N & 63) words.back() &= (uint64_t(1) << (N & 63)) - 1;
+    count = 0;
+    for (uint64_t w : words) count += __builtin_popcountll(w);
+}
+
+bool NodeSet::is_subset_of(const NodeSet& other) const {
+    uint common = std::min(words.size(), other.words.size());
+    for (uint i = 0; i < common; ++i)
+        if (words[i] & ~other.words[i])
+            return false;
+    for (uint i = common; i < words.size(); ++i)
+        if (words[i])
+            return false;
+    return true;
+}
+
+uint NodeSet::intersection_size(const NodeSet& other) const {
+    uint common = std::min(words.size(), other.words.size());
+    uint size = 0;
+    for (uint i = 0; i < common; ++i)
+        size += __builtin_popcountll(words[i] & other.words[i]);
+    return size;
+}
+
+void NodeSet::symmetric_difference(const NodeSet& other, vector<uint>& nodes) const {
+    for (uint i = 0; i < words.size(); ++i)
+        for (uint64_t w = words[i] ^ other.words[i]; w; w &= w - 1)
+            nodes.push_back((i << 6) | __builtin_ctzll(w));
+}
@@ -0,0 +1,180 @@
+/**
+ * @file NodeSet.hh
+ * @author Jaya García
+ * @brief Header of the NodeSet class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef NODE_SET_HH
+# define NODE_SET_HH
+
+# include <vector>
+# include <cstdint>
+
+using namespace std;
+
+using uint = unsigned int;
+
+/** @class NodeSet
+ * @brief Set of nodes of a graph stored as a bitset
+ *
+ * Node identifiers are dense (0..N-1), so a set of nodes is kept
+ * as one bit per node. Membership is a single bit test and subset
+ * or intersection queries are word-wise operations.
+ *
+ */
+class NodeSet {
+
+public:
+
+    /** @class iterator
+     * @brief Forward iterator over the nodes of the set in increasing order
+     *
+     */
+    class iterator {
+
+    public:
+        iterator(const NodeSet* set, uint word);
+
+        uint operator*() const { return (word << 6) | __builtin_ctzll(bits); }
+        iterator& operator++();
+        bool operator==(const iterator& other) const { return word == other.word and bits == other.bits; }
+        bool operator!=(const iterator& other) const { return not (*this == other); }
+
+    private:
+        const NodeSet* set;
+        uint word;
+        uint64_t bits;
+
+        void skip_empty();
+    };
+
+    /**
+     * @brief Construct a new empty Node Set object
+     *
+     */
+    NodeSet();
+
+    /**
+     * @brief Construct a new empty Node Set object
+     *
+     * @param N number of nodes of the graph
+     */
+    NodeSet(uint N);
+
+    /**
+     * @brief Adds a node to the set
+     *
+     * @param u node
+     */
+    void insert(uint u) {
+        uint64_t mask = uint64_t(1) << (u & 63);
+        if (not (words[u >> 6] & mask)) {
+            words[u >> 6] |= mask;
+            ++count;
+        }
+    }
+
+    /**
+     * @brief Removes a node from the set
+     *
+     * @param u node
+     */
+    void erase(uint u) {
+        uint64_t mask = uint64_t(1) << (u & 63);
+        if (words[u >> 6] & mask) {
+            words[u >> 6] &= ~mask;
+            --count;
+        }
+    }
+
+    /**
+     * @brief Checks whether a node is in the set
+     *
+     * @param u node
+     * @return true if u belongs to the set
+     */
+    bool contains(uint u) const {
+        return (words[u >> 6] >> (u & 63)) & 1;
+    }
+
+    /**
+     * @brief Number of nodes in the set
+     *
+     * @return uint size
+     */
+    uint size() const { return count; }
+
+    /**
+     * @brief Checks whether the set has no nodes
+     *
+     * @return true if empty
+     */
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Number of nodes of the graph the set is defined over
+     *
+     * @return uint capacity
+     */
+    uint capacity() const { return N; }
+
+    /**
+     * @brief Removes every node from the set
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Changes the number of nodes of the graph, keeping
+     * the nodes below the new capacity
+     *
+     * @param N number of nodes
+     */
+    void resize(uint N);
+
+    /**
+     * @brief Checks whether every node of this set is in another one
+     *
+     * @param other set
+     * @return true if this set is a subset of other
+     */
+    bool is_subset_of(const NodeSet& other) const;
+
+    /**
+     * @brief Number of nodes in both this set and another one
+     *
+     * @param other set
+     * @return uint size of the intersection
+     */
+    uint intersection_size(const NodeSet& other) const;
+
+    /**
+     * @brief Appends the nodes that are in exactly one of this set and
+     * another one of the same capacity, in increasing order
+     *
+     * @param other set
+     * @param nodes list where the nodes are appended
+     */
+    void symmetric_difference(const NodeSet& other, vector<uint>& nodes) const;
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, words.size()); }
+
+private:
+
+    /** @brief Number of nodes of the graph */
+    uint N = 0;
+
+    /** @brief Number of nodes in the set */
+    uint count = 0;
+
+    /** @brief One bit per node */
+    vector<uint64_t> words;
+};
+
+# endif
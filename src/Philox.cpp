@@ -0,0 +1,89 @@
+/**
+ * @file Philox.cpp
+ * @author Jaya García
+ * @brief Implementation of the Philox class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "Philox.hh"
+# include <cmath>
+# include <utility>
+# include <parallel/algorithm>
+
+// Multipliers and key increments of Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3" (SC 2011)
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+const uint PHILOX_ROUNDS = 10;
+
+Philox::Philox(uint32_t seed, uint32_t dataset, uint16_t threshold, uint32_t replicate, Purpose purpose) {
+    key = {seed, dataset};
+    stream = {replicate, uint32_t(threshold) << 16 | purpose};
+}
+
+array<uint32_t, 4> Philox::block(uint64_t index) const {
+    array<uint32_t, 4> c = {uint32_t(index), uint32_t(index >> 32), stream[0], stream[1]};
+    uint32_t k0 = key[0], k1 = key[1];
+    for (uint r = 0; r < PHILOX_ROUNDS; ++r) {
+        uint64_t p0 = uint64_t(PHILOX_M0)*c[0];
+        uint64_t p1 = uint64_t(PHILOX_M1)*c[2];
+        c = {uint32_t(p1 >> 32) ^ c[1] ^ k0, uint32_t(p1), uint32_t(p0 >> 32) ^ c[3] ^ k1, uint32_t(p0)};
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return c;
+}
+
+Philox::result_type Philox::operator()() {
+    if (next % 4 == 0) buffer = block(next/4);
+    return buffer[next++ % 4];
+}
+
+double Philox::uniform(uint64_t index) const {
+    array<uint32_t, 4> c = block(index);
+    uint64_t bits = uint64_t(c[0]) << 32 | c[1];
+    return (bits >> 11)*0x1.0p-53;
+}
+
+double Philox::normal(uint64_t index) const {
+    // Box-Muller over two uniform values, the first one in (0, 1]
+    array<uint32_t, 4> c = block(index);
+    double u = ((uint64_t(c[0]) << 32 | c[1]) >> 11)*0x1.0p-53;
+    double v = ((uint64_t(c[2]) << 32 | c[3]) >> 11)*0x1.0p-53;
+    return sqrt(-2.0*log(1.0 - u))*cos(2.0*M_PI*v);
+}
+
+void Philox::shuffle(vector<int>& values) {
+    size_t n = values.size();
+    uint64_t first = (next + 3)/4;
+    vector<pair<uint64_t, int>> keys(n);
+    # pragma omp parallel for
+    for (size_t i = 0; i < n; ++i) {
+        array<uint32_t, 4> c = block(first + i);
+        keys[i] = make_pair(uint64_t(c[0]) << 32 | c[1], int(i));
+    }
+    // Equal keys are ordered by position, so the order is always the same
+    __gnu_parallel::sort(keys.begin(), keys.end());
+    vector<int> permuted(n);
+    # pragma omp parallel for
+    for (size_t i = 0; i < n; ++i) permuted[i] = values[keys[i].second];
+    values.swap(permuted);
+    next = (first + n)*4;
+}
+
+ostream& operator<<(ostream& os, const Philox& gen) {
+    return os << gen.key[0] << ' ' << gen.key[1] << ' ' << gen.stream[0] << ' ' << gen.stream[1] << ' ' << gen.next;
+}
+
+istream& operator>>(istream& is, Philox& gen) {
+    is >> gen.key[0] >> gen.key[1] >> gen.stream[0] >> gen.stream[1] >> gen.next;
+    // The buffer holds the block of the next output if it is not the first
+    if (gen.next % 4 != 0) gen.buffer = gen.block(gen.next/4);
+    return is;
+}
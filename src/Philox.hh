@@ -0,0 +1,135 @@
+/**
+ * @file Philox.hh
+ * @author Jaya García
+ * @brief Header of the Philox class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef PHILOX_HH
+# define PHILOX_HH
+
+# include <array>
+# include <vector>
+# include <cstdint>
+# include <iostream>
+
+using namespace std;
+
+using uint = unsigned int;
+
+/**
+ * @brief What a stream of random numbers is drawn for, so that the
+ * draws of one purpose never depend on how many another one made
+ *
+ */
+enum Purpose : uint16_t {
+    PICK_TARGETS, PICK_INITIAL, PICK_CONFIGURATION, PICK_THRESHOLDS, PICK_SUBSETS, PICK_SOURCES
+};
+
+/** @class Philox
+ * @brief Counter based random number generator (Philox4x32-10)
+ *
+ * Every output is a function of its key and its position only: the
+ * key is given by the seed and the dataset, and the counter by the
+ * position, the threshold, the replicate and the purpose of the
+ * stream. A stream can then be regenerated on its own, and any output
+ * can be computed without the ones before it, from any thread.
+ *
+ * It meets the UniformRandomBitGenerator requirements, so it can be
+ * used with the distributions of <random>.
+ *
+ */
+class Philox {
+
+public:
+
+    using result_type = uint32_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    /**
+     * @brief Construct a new Philox object at the start of a stream
+     *
+     * @param seed seed of the experiment
+     * @param dataset dataset
+     * @param threshold threshold of the experiment
+     * @param replicate replicate
+     * @param purpose what the numbers are drawn for
+     */
+    Philox(uint32_t seed = 0, uint32_t dataset = 0, uint16_t threshold = 0, uint32_t replicate = 0, Purpose purpose = PICK_TARGETS);
+
+    /**
+     * @brief Next output of the stream
+     *
+     * @return result_type random 32 bit value
+     */
+    result_type operator()();
+
+    /**
+     * @brief Outputs at a block of the stream, independently of the
+     * position of the generator
+     *
+     * @param index block, each one has 4 outputs
+     * @return array<uint32_t, 4> outputs
+     */
+    array<uint32_t, 4> block(uint64_t index) const;
+
+    /**
+     * @brief Whether two generators draw from the same stream, at any
+     * position
+     *
+     * @param other generator
+     * @return true if they have the same key and stream
+     */
+    bool same_stream(const Philox& other) const { return key == other.key and stream == other.stream; }
+
+    /**
+     * @brief Uniform value in [0, 1) at a block of the stream
+     *
+     * @param index block
+     * @return double value
+     */
+    double uniform(uint64_t index) const;
+
+    /**
+     * @brief Standard normal value at a block of the stream
+     *
+     * @param index block
+     * @return double value
+     */
+    double normal(uint64_t index) const;
+
+    /**
+     * @brief Random permutation of a vector
+     *
+     * Each value gets the 64 bit key of its own block and the values
+     * are sorted by key, so the keys are drawn and sorted in parallel.
+     * The permutation does not depend on the number of threads.
+     *
+     * @param values values to permute
+     */
+    void shuffle(vector<int>& values);
+
+    friend ostream& operator<<(ostream& os, const Philox& gen);
+    friend istream& operator>>(istream& is, Philox& gen);
+
+private:
+
+    array<uint32_t, 2> key;
+
+    /** @brief High words of the counter, the threshold, replicate and purpose */
+    array<uint32_t, 2> stream;
+
+    /** @brief Position of the next output in the stream */
+    uint64_t next = 0;
+
+    /** @brief Block of the last outputs given */
+    array<uint32_t, 4> buffer;
+};
+
+# endif
@@ -1,71 +1,120 @@
 #include "Process_Data.hh"
 # include "Statistics.hh"
+# include <cstring>
+# include <iomanip>
+# include <charconv>
+# include <omp.h>
+# include <thread>
+# include <unistd.h>
+# include <sys/stat.h>
 
-void Process_Data::read_file(VE &V, string fn, bool weighted)
+static const char* skip_spaces(const char* p, const char* end)
 {
-  ifstream file(data_path + fn);
-
-  V = VE();
+  while (p < end and (*p == ' ' or *p == '\t' or *p == '\r')) ++p;
+  return p;
+}
 
-  if (weighted)
-  {
-    int v, u;
-    double w;
-    while (file >> v >> u >> w) V.push_back(edge(v, u, fabs(w)));
-  }
-  else
-  {
-    int v, u;
-    while (file >> v >> u) V.push_back(edge(v, u, 1));
-  }
+template <class T>
+static bool parse_field(const char*& p, const char* end, T& value)
+{
+  p = skip_spaces(p, end);
+  auto r = from_chars(p, end, value);
+  p = r.ptr;
+  return r.ec == errc();
 }
 
-void Process_Data::read_file(VE &V, VD& pg, VD& bw, string name, string fn, bool weighted, bool ignore) {
-    ifstream file(data_path + fn);
-    // cout << data_path + fn << endl;
+// Parses the lines of a mapped file in parallel. The file is split in
+// chunks that start after a newline, every thread parses its chunks into
+// its own buffer and the buffers are joined in file order. Empty lines
+// and comments (starting with # or %) are skipped, and parse returns
+// false on a malformed line
+template <class T, class F>
+static vector<T> parse_lines(const MappedFile& file, string name, uint skip, F parse)
+{
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+  for (uint i = 0; i < skip and begin < end; ++i) begin = min(end, find(begin, end, '\n') + 1);
 
-    V = VE();
+  const size_t MIN_CHUNK = 1 << 16;
+  size_t bytes = end - begin;
+  int num_chunks = max<size_t>(1, min<size_t>(omp_get_max_threads(), bytes/MIN_CHUNK));
+  vector<const char*> start(num_chunks + 1, end);
+  for (int c = 0; c < num_chunks; ++c) {
+    const char* p = begin + bytes*c/num_chunks;
+    if (c > 0 and p[-1] != '\n') p = min(end, find(p, end, '\n') + 1);
+    start[c] = max(p, c > 0 ? start[c-1] : begin);
+  }
 
-    if (weighted) {
-        int v, u;
-        double w;
-        if (not ignore) while (file >> v >> u >> w) V.push_back(edge(v, u, fabs(w)));
-        else while (file >> v >> u >> w) V.push_back(edge(v, u, 1));
-    }
-    else {
-        int v, u;
-        while (file >> v >> u) V.push_back(edge(v, u, 1));
+  vector<vector<T>> values(num_chunks);
+  vector<size_t> lines(num_chunks + 1, 0);
+  vector<vector<size_t>> malformed(num_chunks);
+  # pragma omp parallel for schedule(static, 1)
+  for (int c = 0; c < num_chunks; ++c) {
+    for (const char* p = start[c]; p < start[c+1]; ++lines[c + 1]) {
+      const char* eol = find(p, start[c+1], '\n');
+      const char* q = skip_spaces(p, eol);
+      if (q < eol and *q != '#' and *q != '%' and not parse(q, eol, values[c]))
+        malformed[c].push_back(lines[c + 1]);
+      p = eol < start[c+1] ? eol + 1 : eol;
     }
+  }
 
-    int node;
-    double metric;
-    char comma;
+  // Line numbers of the malformed lines in the whole file
+  for (int c = 0; c < num_chunks; ++c) lines[c + 1] += lines[c];
+  size_t num_malformed = 0;
+  for (int c = 0; c < num_chunks; ++c) {
+    for (size_t l : malformed[c]) {
+      if (++num_malformed <= 5) cerr << name << ": malformed line " << skip + lines[c] + l + 1 << endl;
+    }
+  }
+  if (num_malformed > 5) cerr << name << ": " << num_malformed << " malformed lines" << endl;
 
-    ifstream pg_file(data_metrics + "pagerank/" + name);
+  size_t total = 0;
+  for (auto& v : values) total += v.size();
+  vector<T> result;
+  result.reserve(total);
+  for (auto& v : values) result.insert(result.end(), v.begin(), v.end());
+  return result;
+}
 
-    string header;
-    getline(pg_file, header);      // remove header
-    while (pg_file >> node >> comma >> metric) pg.push_back(metric);
+void Process_Data::read_file(VE &V, string fn, bool weighted)
+{
+  read_file(V, fn, weighted, false);
+}
 
-    ifstream bw_file(data_metrics + "betweenness/" + name);
-    getline(bw_file, header);
-    while (bw_file >> node >> comma >> metric) bw.push_back(metric);
+void Process_Data::read_file(VE &V, VD& pg, VD& bw, string name, string fn, bool weighted, bool ignore) {
+    read_file(V, fn, weighted, ignore);
+    read_centrality(pg, data_metrics + "pagerank/" + name);
+    read_centrality(bw, data_metrics + "betweenness/" + name);
 }
 
 void Process_Data::read_file(VE &V, string fn, bool weighted, bool ignore) {
-    ifstream file(data_path + fn);
-    V = VE();
-
-    if (weighted) {
+    MappedFile file(data_path + fn);
+    V = parse_lines<edge>(file, data_path + fn, 0, [&](const char* p, const char* end, VE& out) {
         int v, u;
-        double w;
-        if (not ignore) while (file >> v >> u >> w) V.push_back(edge(v, u, fabs(w)));
-        else while (file >> v >> u >> w) V.push_back(edge(v, u, 1));
-    }
-    else {
-        int v, u;
-        while (file >> v >> u) V.push_back(edge(v, u, 1));
-    }
+        double w = 1;
+        if (not parse_field(p, end, v) or not parse_field(p, end, u)) return false;
+        if (weighted) {
+            if (not parse_field(p, end, w)) return false;
+            w = ignore ? 1 : fabs(w);
+        }
+        out.push_back(edge(v, u, w));
+        return true;
+    });
+}
+
+void Process_Data::read_centrality(VD& values, string path) {
+    MappedFile file(path);
+    // rows are node,metric after a header
+    values = parse_lines<double>(file, path, 1, [](const char* p, const char* end, VD& out) {
+        int node;
+        double metric;
+        if (not parse_field(p, end, node)) return false;
+        p = skip_spaces(p, end);
+        if (p == end or *p++ != ',' or not parse_field(p, end, metric)) return false;
+        out.push_back(metric);
+        return true;
+    });
 }
 
 void Process_Data::generate_graph(Graph &G, const VE &V, const VD& pg, const VD& bw, bool directed,double th)
@@ -76,58 +125,187 @@ void Process_Data::generate_graph(Graph &G, const VE &V, const VD& pg, const VD&
 
 void Process_Data::read_graph(Graph &G, Data data, double th)
 {
-  VE V;
-  VD pg, bw;
   string name = get_name_data_set(data);
   switch (data)
   {
     case GNUTELLA:
-      read_file(V, pg, bw, name, pGnutella, false, true);     // NON WEIGHTED
-      generate_graph(G, V, pg, bw, true, th);
+      load_graph(G, name, pGnutella, false, true, true, th);     // NON WEIGHTED
       break;
     case AMAZON:
-      read_file(V, pg, bw, name, pAmazon, false, true);       // NON WEIGHTED
-      generate_graph(G, V, pg, bw, false, th);
+      load_graph(G, name, pAmazon, false, true, false, th);      // NON WEIGHTED
       break;
     case HIGGS:
-      read_file(V, pg, bw, name, pHiggs, true, true);         // WEIGHTED
-      generate_graph(G, V, pg, bw, true, th);
+      load_graph(G, name, pHiggs, true, true, true, th);         // WEIGHTED
       break;
     case ARXIV:
-      read_file(V, pg, bw, name, pArxiv, false, true);
-      generate_graph(G, V, pg, bw, false, th);
+      load_graph(G, name, pArxiv, false, true, false, th);
       break;
     case DINING_TABLE:
-      read_file(V, pg, bw, name, pDining_Table, true, true);      // WEIGHTED
-      generate_graph(G, V, pg, bw, true,th);
+      load_graph(G, name, pDining_Table, true, true, true, th);  // WEIGHTED
       break;
     case DOLPHINS:
-      read_file(V, pg, bw, name, pDolphins, false, true);
-      generate_graph(G, V, pg, bw, false,th);
+      load_graph(G, name, pDolphins, false, true, false, th);
       break;
     case HUMAN_BRAIN:
-      read_file(V, pg, bw, name, pHuman_Brain, true, true);      // WEIGHTED
-      generate_graph(G, V, pg, bw, false, th);
+      load_graph(G, name, pHuman_Brain, true, true, false, th);  // WEIGHTED
       break;
     case EPINIONS:
-      read_file(V, pg, bw, name, pEpinions, false, true);
-      generate_graph(G, V, pg, bw, true, th);
+      load_graph(G, name, pEpinions, false, true, true, th);
       break;
     case ENRON:
-      read_file(V, pg, bw, name, pEnron, false, true);
-      generate_graph(G, V, pg, bw, false, th);
+      load_graph(G, name, pEnron, false, true, false, th);
       break;
     case WIKIPEDIA:
-      read_file(V, pg, bw, name, pWikipedia, false, true);
-      generate_graph(G, V, pg, bw, true,th);
+      load_graph(G, name, pWikipedia, false, true, true, th);
       break;
     case CAIDA:
-      read_file(V, pg, bw, name, pCaida, true, true);        // WEIGHTED
-      generate_graph(G, V, pg, bw, true,th);
+      load_graph(G, name, pCaida, true, true, true, th);         // WEIGHTED
       break;
   }
 }
 
+void Process_Data::load_graph(Graph &G, string name, string fn, bool weighted, bool ignore, bool directed, double th)
+{
+  SnapshotHeader key = snapshot_key(name, fn, weighted, ignore, directed);
+  string path = snapshot_path + name + ".bin";
+  if (read_snapshot(G, path, key)) return;
+
+  VE V;
+  VD pg, bw;
+  read_file(V, pg, bw, name, fn, weighted, ignore);
+  generate_graph(G, V, pg, bw, directed, th);
+
+  // Centralities that were not precomputed are computed and cached
+  if (pg.empty() and G.N > 0) {
+    G.pagerank = G.compute_pagerank();
+    write_ranking(G.pagerank, G.mapping, "pagerank/", name, "pagerank");
+    key.pagerank = MappedFile(data_metrics + "pagerank/" + name).stamp();
+  }
+  if (bw.empty() and G.N > 0) {
+    if (G.N <= BETWEENNESS_EXACT_NODES) G.betweenness = G.compute_betweenness();
+    else G.betweenness = G.compute_betweenness(BETWEENNESS_EPSILON, BETWEENNESS_DELTA, BETWEENNESS_SEED);
+    write_ranking(G.betweenness, G.mapping, "betweenness/", name, "betweenness");
+    key.betweenness = MappedFile(data_metrics + "betweenness/" + name).stamp();
+  }
+  write_snapshot(G, path, key);
+}
+
+SnapshotHeader Process_Data::snapshot_key(string name, string fn, bool weighted, bool ignore, bool directed)
+{
+  SnapshotHeader key = SnapshotHeader();
+  memcpy(key.magic, SNAPSHOT_MAGIC, sizeof(key.magic));
+  key.version = SNAPSHOT_VERSION;
+  key.flags = (directed ? 1 : 0) | (weighted ? 2 : 0) | (ignore ? 4 : 0);
+  key.edges = MappedFile(data_path + fn).stamp();
+  key.pagerank = MappedFile(data_metrics + "pagerank/" + name).stamp();
+  key.betweenness = MappedFile(data_metrics + "betweenness/" + name).stamp();
+  return key;
+}
+
+// Sections of a snapshot start at multiples of 8 bytes
+static size_t aligned(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+template <class T>
+static void read_section(const char*& p, vector<T>& values, size_t n)
+{
+  values.resize(n);
+  if (n > 0) memcpy(values.data(), p, n*sizeof(T));
+  p += aligned(n*sizeof(T));
+}
+
+template <class T>
+static void write_section(ofstream& file, const vector<T>& values)
+{
+  const char padding[8] = {};
+  size_t bytes = values.size()*sizeof(T);
+  file.write(reinterpret_cast<const char*>(values.data()), bytes);
+  file.write(padding, aligned(bytes) - bytes);
+}
+
+bool Process_Data::read_snapshot(Graph &G, string path, const SnapshotHeader& key)
+{
+  MappedFile snapshot(path);
+  if (snapshot.size() < sizeof(SnapshotHeader)) return false;
+  SnapshotHeader header;
+  memcpy(&header, snapshot.data(), sizeof(header));
+  if (memcmp(header.magic, key.magic, sizeof(key.magic)) != 0 or header.version != key.version) return false;
+  if (header.flags != key.flags) return false;
+  if (header.edges != key.edges or header.pagerank != key.pagerank or header.betweenness != key.betweenness) return false;
+
+  bool directed = header.flags & 1;
+  size_t N = header.N, A = header.arcs;
+  size_t csr = aligned((N + 1)*sizeof(int)) + aligned(A*sizeof(int)) + aligned(A*sizeof(double));
+  size_t expected = aligned(sizeof(SnapshotHeader)) + aligned(N*sizeof(int)) + N*sizeof(uint64_t)
+                  + (directed ? 2 : 1)*csr + N*sizeof(double)
+                  + aligned(header.num_pagerank*sizeof(double)) + aligned(header.num_betweenness*sizeof(double));
+  if (snapshot.size() != expected) return false;
+
+  G = Graph();
+  G.N = N;
+  G.E = header.E;
+  G.directed = directed;
+  const char* p = snapshot.data() + aligned(sizeof(SnapshotHeader));
+  read_section(p, G.mapping, N);
+  read_section(p, G.id_index, N);
+  read_section(p, G.adjacency.offset, N + 1);
+  read_section(p, G.adjacency.target, A);
+  read_section(p, G.adjacency.weight, A);
+  if (directed) {
+    read_section(p, G.predecessors.offset, N + 1);
+    read_section(p, G.predecessors.target, A);
+    read_section(p, G.predecessors.weight, A);
+  }
+  read_section(p, G.threshold.value, N);
+  read_section(p, G.pagerank, header.num_pagerank);
+  read_section(p, G.betweenness, header.num_betweenness);
+  G.update_contributions();
+  return true;
+}
+
+void Process_Data::write_snapshot(const Graph &G, string path, SnapshotHeader key)
+{
+  key.N = G.N;
+  key.E = G.E;
+  key.arcs = G.adjacency.target.size();
+  key.num_pagerank = G.pagerank.size();
+  key.num_betweenness = G.betweenness.size();
+
+  // Written aside and renamed, so a concurrent reader never sees half a file
+  mkdir(snapshot_path.c_str(), 0755);
+  string tmp = path + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+  ofstream file(tmp, ios::binary);
+  if (not file) return;
+  const char padding[8] = {};
+  file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+  file.write(padding, aligned(sizeof(key)) - sizeof(key));
+  write_section(file, G.mapping);
+  write_section(file, G.id_index);
+  write_section(file, G.adjacency.offset);
+  write_section(file, G.adjacency.target);
+  write_section(file, G.adjacency.weight);
+  if (G.directed) {
+    write_section(file, G.predecessors.offset);
+    write_section(file, G.predecessors.target);
+    write_section(file, G.predecessors.weight);
+  }
+  write_section(file, G.threshold.value);
+  write_section(file, G.pagerank);
+  write_section(file, G.betweenness);
+  file.close();
+  if (file.fail() or rename(tmp.c_str(), path.c_str()) != 0) remove(tmp.c_str());
+}
+
+void Process_Data::write_ranking(const VD &R, const VI &M, string subpath, string fn, string field) {
+    string dir = data_metrics + subpath;
+    mkdir(data_metrics.c_str(), 0755);
+    mkdir(dir.c_str(), 0755);
+    ofstream file(dir + fn);
+    file << "node," << field << endl;
+    file << setprecision(17);
+    for (uint u = 0; u < R.size(); ++u)
+        file << M[u] << "," << R[u] << "\n";
+}
+
 void Process_Data::create_file(string path) {
     ofstream file;
     file.open(path);
@@ -141,7 +319,9 @@ void Process_Data::write_statistics(string path, const Graph& G, const Statistic
     file.open(path, std::ofstream::app);
     file << network << "," << to_string(G.N) << ",";
     file << to_string(stats.pi_I) << "," << to_string(stats.pi_F) << "," << to_string(stats.pi_T) << ",";
-    file << to_string(stats.num_rounds);
+    file << to_string(stats.num_rounds) << ",";
+    file << to_string(stats.num_converged) << "," << to_string(stats.num_cycles) << ",";
+    file << to_string(stats.num_budget) << "," << to_string(stats.cycle_length);
     for (auto& m: METRICS) {
         file << "," << to_string(stats.initial_metrics[m].global_min);
         file << "," << to_string(stats.initial_metrics[m].global_max);
@@ -9,6 +9,7 @@
 #include <cmath>
 #include "Graph.hh"
 # include "Statistics.hh"
+# include "MappedFile.hh"
 #include <chrono>
 #include <utility>
 
@@ -32,6 +33,19 @@ typedef struct
 
 typedef vector<PST> VPST;
 
+// Binary copy of a graph built from its edge list and centralities. The
+// stamps of the sources tell whether the snapshot is still valid
+const char SNAPSHOT_MAGIC[8] = {'T', 'I', 'M', 'G', 'S', 'N', 'A', 'P'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;             // directed, weighted, ignore
+    FileStamp edges, pagerank, betweenness;
+    uint64_t N, E, arcs, num_pagerank, num_betweenness;
+};
 
 
 enum Data
@@ -57,16 +71,32 @@ private:
     string data_path = "../data/networks/";
     string data_metrics = "../data/centralities/";
     string outpath = "../data/results/";
+    string snapshot_path = "../data/snapshots/";
 
-    string result_header = "Network,N,InitialProp,InfluenceProp,InfluenceTargetProp,Rounds,MinDegreeIni,MaxDegreeIni,AvgDegreeIni,MinPageIni,MaxPageIni,AvgPageIni,MinBtwIni,MaxBtwIni,AvgBtwIni,MinDegreeTar,MaxDegreeTar,AvgDegreeTar,MinPageTar,MaxPageTar,AvgPageTar,MinBtwTar,MaxBtwTar,AvgBtwTar";
+    // Missing betweenness files are computed exactly up to this size,
+    // and from sampled sources on larger graphs
+    const uint BETWEENNESS_EXACT_NODES = 20000;
+    const double BETWEENNESS_EPSILON = 0.01;
+    const double BETWEENNESS_DELTA = 0.1;
+    const uint BETWEENNESS_SEED = 2000;
+
+    string result_header = "Network,N,InitialProp,InfluenceProp,InfluenceTargetProp,Rounds,Converged,Cycles,Budget,CycleLength,MinDegreeIni,MaxDegreeIni,AvgDegreeIni,MinPageIni,MaxPageIni,AvgPageIni,MinBtwIni,MaxBtwIni,AvgBtwIni,MinDegreeTar,MaxDegreeTar,AvgDegreeTar,MinPageTar,MaxPageTar,AvgPageTar,MinBtwTar,MaxBtwTar,AvgBtwTar";
 
     void read_file(VE &V,string fn, bool weighted);
     void read_file(VE &V, string fn, bool weighted, bool ignore);
     void read_file(VE &V, VD& pg, VD& bw, string name, string fn, bool weighted, bool ignore);
+    void read_centrality(VD& values, string path);
 
     // void generate_graph(Graph &G, const VE &V, bool directed,double th);
     void generate_graph(Graph &G, const VE &V, const VD& pg, const VD& bw, bool directed, double th);
 
+    // Builds the graph from its snapshot, or from the sources writing the
+    // snapshot for the next time
+    void load_graph(Graph &G, string name, string fn, bool weighted, bool ignore, bool directed, double th);
+    SnapshotHeader snapshot_key(string name, string fn, bool weighted, bool ignore, bool directed);
+    bool read_snapshot(Graph &G, string path, const SnapshotHeader& key);
+    void write_snapshot(const Graph &G, string path, SnapshotHeader key);
+
     bool is_empty(ifstream &file);
 
 public:
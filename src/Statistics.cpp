@@ -18,19 +18,31 @@ Statistics::Statistics(uint N) {
     thresholds = VD(N, 0.0);
 }
 
-void Statistics::update_metrics(const Graph& G, USI& initial, USI& target, USI& influence_expansion, uint rounds) {
+void Statistics::update_metrics(const Graph& G, const Thresholds& ths, NodeSet& initial, NodeSet& target, NodeSet& influence_expansion, const DynamicsOutcome& outcome) {
     uint influence_size = G.intersection_size(target, influence_expansion);
     pi_I += (double) initial.size()/G.N;
     pi_F += (double) influence_expansion.size()/G.N;
     pi_T += (double) influence_size/target.size();
-    num_rounds += rounds;
+    num_rounds += outcome.rounds;
+    switch (outcome.termination) {
+        case CONVERGED:
+            ++num_converged;
+            break;
+        case CYCLE:
+            ++num_cycles;
+            cycle_length += outcome.cycle_length;
+            break;
+        case BUDGET:
+            ++num_budget;
+            break;
+    }
 
     for (auto& m: METRICS) {
-        for (auto& v: initial) {
+        for (auto v: initial) {
             double value = get_metric(G, v, m, true);
             initial_metrics[m].add(value);
         }
-        for (auto& v: influence_expansion) {
+        for (auto v: influence_expansion) {
             double value = get_metric(G, v, m, false);
             influence_metrics[m].add(value);
         }
@@ -43,7 +55,7 @@ void Statistics::update_metrics(const Graph& G, USI& initial, USI& target, USI&
             uint degree = G.in_degree(u);
             if (degree == 0) 
                 degree = 1;
-            thresholds[u] += (double) G.threshold[u]/degree;
+            thresholds[u] += (double) ths.value[u]/degree;
         }
 }
 
@@ -52,6 +64,7 @@ void Statistics::average_statistics(uint num_reps) {
     pi_F /= num_reps;
     pi_T /= num_reps;
     num_rounds /= num_reps;
+    if (num_cycles > 0) cycle_length /= num_cycles;
 
     for (auto& m: METRICS) {
         initial_metrics[m].global_average(num_reps);
@@ -85,6 +98,8 @@ void Statistics::print() const {
     cout << "Proportion of initial nodes " << pi_I << endl;
     cout << "Proportion of influenced nodes " << pi_F << endl;
     cout << "Proportion of target influenced nodes " << pi_T << endl;
+    cout << "Executions converged " << num_converged << ", in a cycle " << num_cycles;
+    cout << " (average length " << cycle_length << "), out of budget " << num_budget << endl;
     for (auto& m: METRICS) {
         switch(m) {
             case DEGREE:
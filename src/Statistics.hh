@@ -14,6 +14,7 @@
 
 # include <limits>
 # include "Graph.hh"
+# include "InfluenceMaximization.hh"
 
 enum Metric {DEGREE, PAGERANK, BETWENNESS};
 
@@ -130,6 +131,14 @@ public:
     /** @brief Number of rounds played */
     double num_rounds = 0.0;
 
+    /** @brief Number of executions ended by each Termination */
+    uint num_converged = 0;
+    uint num_cycles = 0;
+    uint num_budget = 0;
+
+    /** @brief Length of the cycles found */
+    double cycle_length = 0.0;
+
     /** @brief Metrics of the initial set */
     vector<MetricSummary> initial_metrics = vector<MetricSummary>(NUM_METRICS);
 
@@ -159,12 +168,13 @@ public:
      * partial results
      * 
      * @param G network
+     * @param ths thresholds of the nodes at the end of the game
      * @param initial initial set
      * @param target target set
      * @param influence_expansion influenced set
-     * @param rounds number of rounds taken
+     * @param outcome how the dynamics ended
      */
-    void update_metrics(const Graph& G, USI& initial, USI& target, USI& influence_expansion, uint rounds);
+    void update_metrics(const Graph& G, const Thresholds& ths, NodeSet& initial, NodeSet& target, NodeSet& influence_expansion, const DynamicsOutcome& outcome);
     
     /**
      * @brief Averages the results from different results
@@ -0,0 +1,149 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Jaya García
+ * @brief Implementation of the ThreadPool class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "ThreadPool.hh"
+# include <omp.h>
+
+thread_local int ThreadPool::worker_id = -1;
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(max(1, omp_get_max_threads()));
+    return pool;
+}
+
+ThreadPool::ThreadPool(uint num_threads) {
+    // The thread that waits works too, so it does not need a worker
+    for (uint i = 0; i < num_threads; ++i) queues.emplace_back(new Queue());
+    for (uint i = 0; i + 1 < num_threads; ++i)
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& t : workers) t.join();
+}
+
+void ThreadPool::submit(TaskGroup& group, function<void()> task) {
+    ++group.pending;
+    ++group.queued;
+    Queue& q = *queues[worker_id >= 0 ? worker_id : queues.size() - 1];
+    {
+        lock_guard<mutex> guard(q.lock);
+        q.tasks.push_back(Task{move(task), &group});
+        ++num_queued;
+    }
+    // Taking the lock orders the new task before any worker goes to sleep
+    { lock_guard<mutex> guard(sleep_lock); }
+    wake.notify_one();
+    // Only the thread waiting for the group may run the new task as well
+    group.done.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup& group) {
+    Task task;
+    while (group.pending > 0) {
+        if (find_task(task, group)) {
+            execute(task);
+            continue;
+        }
+        // Sleeps until the group finishes or gets a task to run
+        unique_lock<mutex> guard(sleep_lock);
+        group.done.wait(guard, [&] { return group.pending == 0 or group.queued > 0; });
+    }
+    // The thread that ran the last task may still be notifying the group
+    lock_guard<mutex> guard(sleep_lock);
+}
+
+bool ThreadPool::pop(Queue& q, bool newest, Task& task) {
+    if (q.tasks.empty()) return false;
+    if (newest) {
+        task = move(q.tasks.back());
+        q.tasks.pop_back();
+    }
+    else {
+        task = move(q.tasks.front());
+        q.tasks.pop_front();
+    }
+    --task.group->queued;
+    --num_queued;
+    return true;
+}
+
+bool ThreadPool::find_task(Task& task) {
+    if (num_queued == 0) return false;
+    uint num_queues = queues.size();
+    uint own = worker_id >= 0 ? worker_id : num_queues - 1;
+
+    // Newest task of the own queue first, then the oldest of the others
+    for (uint i = 0; i < num_queues; ++i) {
+        Queue& q = *queues[(own + i) % num_queues];
+        lock_guard<mutex> guard(q.lock);
+        if (pop(q, i == 0, task)) return true;
+    }
+    return false;
+}
+
+bool ThreadPool::find_task(Task& task, TaskGroup& group) {
+    if (group.queued == 0) return false;
+    uint num_queues = queues.size();
+    uint own = worker_id >= 0 ? worker_id : num_queues - 1;
+
+    // Same order as above, skipping the tasks of other groups
+    for (uint i = 0; i < num_queues; ++i) {
+        Queue& q = *queues[(own + i) % num_queues];
+        lock_guard<mutex> guard(q.lock);
+        uint n = q.tasks.size();
+        for (uint j = 0; j < n; ++j) {
+            uint k = i == 0 ? n - 1 - j : j;
+            if (q.tasks[k].group != &group) continue;
+            task = move(q.tasks[k]);
+            q.tasks.erase(q.tasks.begin() + k);
+            --group.queued;
+            --num_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task) {
+    int num_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    task.run();
+    omp_set_num_threads(num_threads);
+    TaskGroup* group = task.group;
+    task = Task();
+    // The group may be gone once its waiter sees no pending task, so the
+    // last one is counted and notified while the waiter cannot return
+    uint pending = group->pending;
+    while (pending > 1 and not group->pending.compare_exchange_weak(pending, pending - 1)) {}
+    if (pending > 1) return;
+    lock_guard<mutex> guard(sleep_lock);
+    if (--group->pending == 0) group->done.notify_one();
+}
+
+void ThreadPool::worker_loop(uint id) {
+    worker_id = id;
+    Task task;
+    while (true) {
+        if (find_task(task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> guard(sleep_lock);
+        wake.wait(guard, [this] { return stopping or num_queued > 0; });
+        if (stopping and num_queued == 0) return;
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file ThreadPool.hh
+ * @author Jaya García
+ * @brief Header of the ThreadPool class
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# ifndef THREAD_POOL_HH
+# define THREAD_POOL_HH
+
+# include <vector>
+# include <deque>
+# include <memory>
+# include <mutex>
+# include <thread>
+# include <atomic>
+# include <functional>
+# include <condition_variable>
+
+using namespace std;
+
+using uint = unsigned int;
+
+/** @class ThreadPool
+ * @brief Process wide work stealing scheduler with a fixed number of threads
+ *
+ * Every worker keeps its own queue: it runs the last task it submitted
+ * first and, when its queue is empty, steals the oldest task of another
+ * one. A thread waiting for a group of tasks runs the pending tasks of
+ * that group in the meantime, so tasks can submit and wait for other
+ * tasks at any depth without adding threads. It never runs a task of
+ * another group, which could keep it blocked long after its own group
+ * finished.
+ *
+ * The OpenMP regions reached from a task run with a single thread, as
+ * the parallelism comes from the pool.
+ *
+ */
+class ThreadPool {
+
+public:
+
+    /** @class TaskGroup
+     * @brief Set of tasks that can be waited for together
+     *
+     */
+    class TaskGroup {
+        friend class ThreadPool;
+        atomic<uint> pending{0};
+        // Tasks of the group still in a queue
+        atomic<uint> queued{0};
+        // Wakes the thread waiting for the group, when it finishes or
+        // gets a new task
+        condition_variable done;
+    };
+
+    /**
+     * @brief Pool of the process, created on first use with as many
+     * threads as OpenMP would use (OMP_NUM_THREADS)
+     *
+     * @return ThreadPool& pool
+     */
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Number of threads that run tasks, counting the waiting one
+     *
+     * @return uint number of threads
+     */
+    uint size() const { return workers.size() + 1; }
+
+    /**
+     * @brief Adds a task to a group
+     *
+     * @param group group of the task
+     * @param task function to run
+     */
+    void submit(TaskGroup& group, function<void()> task);
+
+    /**
+     * @brief Runs pending tasks of a group until every one of them has
+     * finished, and sleeps while the others run on other threads
+     *
+     * @param group group of tasks
+     */
+    void wait(TaskGroup& group);
+
+    /**
+     * @brief Runs f(0), ..., f(n-1) as tasks and waits for all of them
+     *
+     * @param n number of iterations
+     * @param f function of the iteration
+     */
+    template <class F>
+    void parallel_for(uint n, const F& f) {
+        TaskGroup group;
+        for (uint i = 0; i < n; ++i) submit(group, [&f, i] { f(i); });
+        wait(group);
+    }
+
+private:
+
+    struct Task {
+        function<void()> run;
+        TaskGroup* group = nullptr;
+    };
+
+    struct Queue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    /** @brief One queue per worker, the last one for any other thread */
+    vector<unique_ptr<Queue>> queues;
+
+    vector<thread> workers;
+
+    /** @brief Number of tasks waiting in any queue */
+    atomic<uint> num_queued{0};
+
+    mutex sleep_lock;
+    condition_variable wake;
+
+    bool stopping = false;
+
+    /** @brief Queue of the calling worker, -1 outside the pool */
+    static thread_local int worker_id;
+
+    ThreadPool(uint num_threads);
+
+    bool find_task(Task& task);
+    bool find_task(Task& task, TaskGroup& group);
+    bool pop(Queue& q, bool newest, Task& task);
+    void execute(Task& task);
+    void worker_loop(uint id);
+};
+
+# endif
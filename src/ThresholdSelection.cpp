@@ -1,30 +1,19 @@
 # include "ThresholdSelection.hh"
+# include "ThreadPool.hh"
 # include <iostream>
+# include <algorithm>
 
-ThresholdSelection::ThresholdSelection(Graph& H) : InfluenceMaximization(H) { }
+ThresholdSelection::ThresholdSelection(const Graph& H) : InfluenceMaximization(H), spread(H, thresholds) { }
 
-ThresholdSelection::ThresholdSelection(Graph& H, bool malicious) : InfluenceMaximization(H) {
+ThresholdSelection::ThresholdSelection(const Graph& H, bool malicious) : InfluenceMaximization(H), spread(H, thresholds) {
     this->malicious = malicious;
 }
 
-void ThresholdSelection::select_initial_configuration(string mode) {
-    NP = G.N - num_target - num_initial;
-    if(mode == "random") {
-
-    }
-    else if (mode == "empty") {
-        for (uint u = 0; u < G.N; ++u)
-            if (nodes_type[u] != TARGET)
-                strategy_profile.insert(make_pair(u, 1));
-    }
-    else if (mode == "complete") {
-        for (uint u = 0; u < G.N; ++u)
-            if (nodes_type[u] != TARGET)
-                strategy_profile.insert(make_pair(u, G.in_degree(u)));
-    }
+ThresholdSelection::ThresholdSelection(const Graph& H, const Thresholds& ths, bool malicious) : InfluenceMaximization(H, ths), spread(H, thresholds) {
+    this->malicious = malicious;
 }
 
-void ThresholdSelection::select_initial_configuration(string mode, std::mt19937 gen) {
+void ThresholdSelection::select_initial_configuration(string mode) {
     NP = G.N - num_target - num_initial;
     if(mode == "random") {
 
@@ -32,19 +21,17 @@ void ThresholdSelection::select_initial_configuration(string mode, std::mt19937
     else if (mode == "empty") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile.insert(make_pair(u, 1));
+                set_strategy(u, 1);
     }
     else if (mode == "complete") {
         for (uint u = 0; u < G.N; ++u)
             if (nodes_type[u] != TARGET)
-                strategy_profile.insert(make_pair(u, G.in_degree(u)));
+                set_strategy(u, G.in_degree(u));
     }
 }
 
 int ThresholdSelection::compute_utility(int u) {
-    USI influence_expansion;
-    G.expand_influence(initial_set, influence_expansion);
-    bool target_influenced = G.is_subset(target_set, influence_expansion);
+    bool target_influenced = G.influences_all(initial_set, thresholds, target_set, workspace);
     if (malicious) {
         if (not target_influenced)
             return strategy_profile[u];
@@ -60,45 +47,199 @@ int ThresholdSelection::compute_utility(int u) {
 }
 
 int ThresholdSelection::best_response(int u) {
-    int best_ths;
+    int best_ths = best_threshold(u, batch_workspace);
+    G.assign_threshold(thresholds, u, best_ths);
+    return best_ths;
+}
+
+int ThresholdSelection::best_threshold(int u, BatchWorkspace& ws) const {
+    // Thresholds in the order the agent tries them: malicious agents go
+    // down from the in-degree and cooperative ones go up from 1
+    int degree = G.in_degree(u);
+    VI candidates;
     if (malicious) {
-        best_ths = G.in_degree(u);
-        G.assign_threshold(u, best_ths);
-        USI influence_spread;
-        G.expand_influence(initial_set, influence_spread);
-        if (not G.is_subset(target_set, influence_spread)) {
-            for (int ths = best_ths-1; ths > 0; --ths) {
-                G.assign_threshold(u, ths);
-                influence_spread.clear();
-                G.expand_influence(initial_set, influence_spread);
-                if (G.is_subset(target_set, influence_spread))
-                    return best_ths;
-                best_ths = ths;
-            }
-        }
+        candidates.push_back(degree);
+        for (int ths = degree-1; ths > 0; --ths) candidates.push_back(ths);
     }
     else {
-        best_ths = 1;
-        G.assign_threshold(u, best_ths);
-        USI influence_spread;
-        G.expand_influence(initial_set, influence_spread);
-        if (G.is_subset(target_set, influence_spread)) {
-            for (int ths = 2; ths < G.in_degree(u); ++ths) {
-                G.assign_threshold(u, ths);
-                influence_spread.clear();
-                G.expand_influence(initial_set, influence_spread);
-                if (not G.is_subset(target_set, influence_spread))
-                    return best_ths;
-                best_ths = ths;
+        candidates.push_back(1);
+        for (int ths = 2; ths < degree; ++ths) candidates.push_back(ths);
+    }
+
+    // The agent keeps moving while the first candidate leaves the target set
+    // as it does not want it (influenced for cooperative agents and not
+    // influenced for malicious ones), and stops at the last candidate before
+    // that changes. The spread only grows as the threshold of u goes down,
+    // so along the candidates the target set changes at most once and the
+    // change is found with a 64-ary search, one batched spread per step.
+    int n = candidates.size();
+    vector<SpreadScenario> scenarios;
+    VI probes, reached;
+    auto probe = [&](int lo, int hi, bool with_first) {
+        // Up to 64 candidates evenly spread strictly between lo and hi
+        probes.clear();
+        if (with_first) probes.push_back(0);
+        int m = min<int>(MAX_SCENARIOS - probes.size(), hi - lo - 1);
+        for (int j = 1; j <= m; ++j)
+            probes.push_back(lo + int((long long)(hi - lo)*j/(m + 1)));
+        scenarios.assign(probes.size(), SpreadScenario());
+        for (uint b = 0; b < probes.size(); ++b) {
+            scenarios[b].node = u;
+            scenarios[b].threshold = candidates[probes[b]];
+        }
+        G.influenced_targets_batch(initial_set, thresholds, scenarios, target_set, reached, ws);
+    };
+    auto influenced = [&](uint b) { return reached[b] == int(target_set.size()); };
+
+    // The change is after lo and not after hi, hi = n meaning no change
+    int lo = 0, hi = n;
+    probe(lo, hi, true);
+    bool first_influenced = influenced(0);
+    if (first_influenced == malicious) return candidates[0];
+    uint b = 1;
+    while (true) {
+        while (b < probes.size() and influenced(b) == first_influenced) lo = probes[b++];
+        if (b < probes.size()) hi = probes[b];
+        if (hi - lo <= 1) break;
+        probe(lo, hi, false);
+        b = 0;
+    }
+    return candidates[lo];
+}
+
+bool ThresholdSelection::moves_to(int u, int ths) const {
+    // Until an agent is evaluated its threshold may differ from its strategy
+    return strategy_profile.at(u) != ths or thresholds.value[u] != ths;
+}
+
+void ThresholdSelection::set_strategy(int u, int ths) {
+    auto it = strategy_profile.emplace(u, 0).first;
+    update_hash(u, it->second, ths);
+    it->second = ths;
+}
+
+void ThresholdSelection::commit_move(int u, int ths) {
+    if (thresholds.value[u] != strategy_profile.at(u)) --num_unsynced;
+    set_strategy(u, ths);
+    G.assign_threshold(thresholds, u, ths);
+}
+
+DynamicsOutcome ThresholdSelection::sequential_dynamics(const VI& players, const Checkpoint* resume) {
+    PlayerQueue queue(players, G.N);
+    NodeSet previous, affected;
+    // The spread is only needed to find the affected agents, so it is
+    // not kept up to date while every agent is queued anyway
+    bool spread_valid = false;
+    uint last_round = 0;
+    uint num_moves = 0;
+    if (resume) {
+        queue.restore(*resume);
+        last_round = resume->header.last_round;
+        num_moves = resume->header.num_moves;
+    }
+    int v;
+    while (true) {
+        if (checkpoint_due())
+            write_checkpoint(kind(), strategies(), queue.round(), last_round, num_moves, &queue);
+        if (not queue.pop(v)) break;
+        if (out_of_budget(queue.round()))
+            return DynamicsOutcome{BUDGET, queue.round() - 1, 0};
+        int br = best_threshold(v, batch_workspace);
+        // The threshold changes as well the first time an agent plays
+        if (not moves_to(v, br)) continue;
+        // If the strategy profile is different from
+        // the best response then agent can improve
+        bool improves = strategy_profile[v] != br;
+        // A threshold that only catches up with the strategy changes the
+        // spread as well, so the round is not the last one either
+        last_round = queue.round();
+        if (queue.num_clean() == 0) {
+            commit_move(v, br);
+            spread_valid = false;
+        }
+        else {
+            if (not spread_valid) spread.build(initial_set, target_set);
+            previous = spread.influenced;
+            uint previous_targets = spread.influenced_targets();
+            commit_move(v, br);
+            spread.build(initial_set, target_set);
+            spread_valid = true;
+            // The best responses depend on how many targets are influenced,
+            // so a move that changes it queues every agent. Otherwise the
+            // search stops once it finds more agents than the ones still
+            // to skip, as they would all be queued anyway
+            if (spread.influenced_targets() == previous_targets
+                and spread.affected_by(v, previous, affected, queue.num_clean(), workspace)) {
+                for (auto w : affected)
+                    if (int(w) != v) queue.push(w);
             }
+            else queue.push_all();
+        }
+        // The profile only gives the state once it gives the thresholds
+        if (improves and num_unsynced == 0) {
+            uint length = repeated_state(v, ++num_moves);
+            if (length > 0) return DynamicsOutcome{CYCLE, last_round, length};
         }
     }
-    return best_ths;
+    // The sweeps end with a round where no agent improves
+    return DynamicsOutcome{CONVERGED, last_round + 1, 0};
 }
 
-uint ThresholdSelection::game_dynamics() {
-    bool some_improved = true;
+DynamicsOutcome ThresholdSelection::jacobi_dynamics(const VI& players, const Checkpoint* resume) {
+    ThreadPool& pool = ThreadPool::instance();
+    uint num_chunks = min<uint>(players.size(), 4*pool.size());
+    round_workspaces.resize(num_chunks);
+    VI response(players.size());
     uint n_rounds = 0;
+    // No rule of this game draws random subsets, so a profile that ends
+    // two rounds makes them repeat
+    if (resume) n_rounds = resume->header.round;
+    else if (num_unsynced == 0) repeated_state(-1, 0);
+    while (true) {
+        if (checkpoint_due()) write_checkpoint(kind(), strategies(), n_rounds, 0, 0);
+        if (out_of_budget(n_rounds + 1))
+            return DynamicsOutcome{BUDGET, n_rounds, 0};
+        ++n_rounds;
+        // Best responses against the profile of the previous round
+        pool.parallel_for(num_chunks, [&](uint c) {
+            uint first = players.size()*c/num_chunks;
+            uint last = players.size()*(c + 1)/num_chunks;
+            for (uint i = first; i < last; ++i)
+                response[i] = best_threshold(players[i], round_workspaces[c]);
+        });
+        VI movers, moves;
+        for (uint i = 0; i < players.size(); ++i) {
+            if (moves_to(players[i], response[i])) {
+                movers.push_back(players[i]);
+                moves.push_back(response[i]);
+            }
+        }
+        if (movers.empty()) return DynamicsOutcome{CONVERGED, n_rounds, 0};
+        commit_moves(movers, moves);
+        if (num_unsynced > 0) continue;
+        uint length = repeated_state(-1, n_rounds);
+        if (length > 0) return DynamicsOutcome{CYCLE, n_rounds, length};
+    }
+}
+
+void ThresholdSelection::commit_moves(const VI& movers, const VI& moves) {
+    if (conflict_rule == SPECULATIVE) {
+        // Each mover takes its best threshold again given the thresholds
+        // committed before it in the round, and keeps its own otherwise
+        for (int u: movers) {
+            int ths = best_threshold(u, batch_workspace);
+            if (moves_to(u, ths)) commit_move(u, ths);
+        }
+        return;
+    }
+    // SINGLE_MOVER and INDEPENDENT_SET. No quantity decreases with the
+    // moves of this game, so a joint move of a subset could undo an earlier
+    // one forever: the round commits the first mover only
+    commit_move(movers[0], moves[0]);
+}
+
+DynamicsOutcome ThresholdSelection::game_dynamics() {
+    DynamicsOutcome outcome;
     VI player_nodes(NP);
     uint index = 0;
     for (uint v = 0; v < G.N; ++v) {
@@ -107,31 +248,40 @@ uint ThresholdSelection::game_dynamics() {
             ++index;
         }
     }
-    while (some_improved) {
-        some_improved = false;
-        for (auto& v: player_nodes) {
-            int br = best_response(v);
-            // If the strategy profile is different from
-            // the best response then agent can improve
-            if (strategy_profile[v] != br) {
-                strategy_profile[v] = br;
-                G.assign_threshold(v, br);
-                some_improved = true;
-            }
-        }
-        ++n_rounds;
+    start_dynamics();
+    Checkpoint resume;
+    bool resumed = read_checkpoint(kind(), resume);
+    if (resumed) {
+        for (uint u = 0; u < G.N; ++u)
+            if (resume.strategy[u] >= 0) set_strategy(u, resume.strategy[u]);
+        thresholds.value = resume.threshold;
+        G.update_threshold_counts(thresholds);
     }
-    G.expand_influence(initial_set, final_influence);
-    return n_rounds;
+    num_unsynced = 0;
+    for (int u: player_nodes)
+        if (thresholds.value[u] != strategy_profile.at(u)) ++num_unsynced;
+    if (dynamics == JACOBI)
+        outcome = jacobi_dynamics(player_nodes, resumed ? &resume : nullptr);
+    else
+        outcome = sequential_dynamics(player_nodes, resumed ? &resume : nullptr);
+    // Out of budget, the dynamics can still go on from the checkpoint
+    if (outcome.termination != BUDGET) remove_checkpoint();
+    G.expand_influence_parallel(initial_set, thresholds, final_influence);
+    return outcome;
+}
+
+VI ThresholdSelection::strategies() const {
+    VI strategy(G.N, -1);
+    for (auto& s: strategy_profile)
+        strategy[s.first] = s.second;
+    return strategy;
 }
 
 void ThresholdSelection::print_profile() const {
     cout << "Strategy profile: ";
     print(nodes_type);
     cout << "                  ";
-    VI strategy(G.N, -1);
-    for (auto& s: strategy_profile)
-        strategy[s.first] = s.second;
+    VI strategy = strategies();
     for (uint v = 0; v < G.N; ++v) {
         if (strategy[v] == -1)
             cout << "- ";
@@ -13,6 +13,7 @@
 # define THRESHOLD_SELECTION_HH
 
 # include "InfluenceMaximization.hh"
+# include "IncrementalSpread.hh"
 
 /**
  * @brief Class for the Threshold Selection Game
@@ -32,13 +33,28 @@ public:
     /** @brief Variable for the type of the agents, False for cooperative True otherwise */
     bool malicious = false;
 
+    /** @brief Reusable state for the batched threshold evaluations */
+    BatchWorkspace batch_workspace;
+
+    /** @brief Batch state of each part of the players evaluated in
+     * parallel by the Jacobi dynamics */
+    vector<BatchWorkspace> round_workspaces;
+
+    /** @brief Number of players whose threshold is not their strategy
+     * yet. Until it is 0 the profile is not the state of the dynamics */
+    uint num_unsynced = 0;
+
+    /** @brief Spread of the current thresholds, used to find the agents
+     * affected by a move in the sequential dynamics */
+    IncrementalSpread spread;
+
     /**
      * @brief Construct a new Threshold Selection object
      * 
      * @param H network
      * 
      */
-    ThresholdSelection(Graph& H);
+    ThresholdSelection(const Graph& H);
 
     /**
      * @brief Construct a new Threshold Selection object
@@ -46,25 +62,24 @@ public:
      * @param H network
      * @param malicious type of the agents 
      */
-    ThresholdSelection(Graph& H, bool malicious);
+    ThresholdSelection(const Graph& H, bool malicious);
 
     /**
-     * @brief Initializes the strategy profile with a given set
+     * @brief Construct a new Threshold Selection object
      * 
-     * @param mode string with the mode of initialization
-     *             "empty" | "complete" | "random"
+     * @param H network
+     * @param ths thresholds the agents start from
+     * @param malicious type of the agents 
      */
-    void select_initial_configuration(string mode);
+    ThresholdSelection(const Graph& H, const Thresholds& ths, bool malicious);
 
     /**
-     * @brief Initializes the strategy profile with a given
-     * random number generator
+     * @brief Initializes the strategy profile with a given set
      * 
      * @param mode string with the mode of initialization
      *             "empty" | "complete" | "random"
-     * @param gen random number generator
      */
-    void select_initial_configuration(string mode, std::mt19937 gen);
+    void select_initial_configuration(string mode);
     
     /**
      * @brief Computes the utility of an agent for a given action
@@ -78,17 +93,115 @@ public:
     /**
      * @brief Computes the Best Response of an agent in the game
      * 
+     * The candidate thresholds are evaluated in batches of spreads, and
+     * the threshold of u in the game is left at the returned best response
+     * 
      * @param u node
      * @return int Best Response strategy
      */
     int best_response(int u);
 
+    /**
+     * @brief Computes the Best Response of an agent without changing
+     * the thresholds, using the batch state of the calling thread
+     * 
+     * @param u node
+     * @param ws workspace of the calling thread
+     * @return int Best Response strategy
+     */
+    int best_threshold(int u, BatchWorkspace& ws) const;
+
+    /**
+     * @brief Whether an agent has to change to a threshold, either its
+     * strategy or the threshold it has in the game
+     * 
+     * @param u node
+     * @param ths threshold
+     * @return true if u moves
+     */
+    bool moves_to(int u, int ths) const;
+
+    /**
+     * @brief Sets the strategy of an agent, along with the profile hash
+     * 
+     * @param u node
+     * @param ths threshold
+     */
+    void set_strategy(int u, int ths);
+
+    /**
+     * @brief Sets the strategy and the threshold of an agent
+     * 
+     * @param u node
+     * @param ths threshold
+     */
+    void commit_move(int u, int ths);
+
+    /**
+     * @brief Plays best responses one agent at a time until no agent
+     * improves
+     * 
+     * Only the agents whose best response may have changed since they
+     * were last evaluated are evaluated again, in the order of full
+     * sweeps over the players. The best responses depend on whether
+     * every target is influenced, so a move that changes the number of
+     * influenced targets queues every agent again, and any other one the
+     * agents around it (see IncrementalSpread::affected_by). The profiles
+     * visited are the ones of the sweeps.
+     * 
+     * Stops at the first profile visited twice after a move of the same
+     * agent, or when the budget runs out.
+     * 
+     * @param players player nodes
+     * @param resume checkpoint the dynamics go on from, if any
+     * @return DynamicsOutcome outcome, with the rounds the sweeps would
+     * have played
+     */
+    DynamicsOutcome sequential_dynamics(const VI& players, const Checkpoint* resume = nullptr);
+
+    /**
+     * @brief Plays Jacobi rounds until no agent improves
+     * 
+     * Stops at the first profile that ends two rounds, or when the
+     * budget runs out. Every rule is deterministic here, INDEPENDENT_SET
+     * being played as SINGLE_MOVER (see ConflictRule), so the dynamics
+     * end even without a budget.
+     * 
+     * @param players player nodes
+     * @param resume checkpoint the dynamics go on from, if any
+     * @return DynamicsOutcome outcome
+     */
+    DynamicsOutcome jacobi_dynamics(const VI& players, const Checkpoint* resume = nullptr);
+
+    /**
+     * @brief Commits the improving moves of a Jacobi round
+     * following the conflict rule
+     * 
+     * @param movers agents that change their threshold
+     * @param moves best response of every mover
+     */
+    void commit_moves(const VI& movers, const VI& moves);
+
     /**
      * @brief Simulates the Best Response Dynamics of the game
      * 
-     * @return uint number of rounds played
+     * Resumes from the checkpoint of checkpoint_path if resume is set and
+     * it holds one of this game, and writes one every checkpoint_seconds.
+     * 
+     * @return DynamicsOutcome how the dynamics ended
+     */
+    DynamicsOutcome game_dynamics();
+
+    /** @brief Game in the checkpoints, 1 for cooperative agents and 2
+     * for malicious ones */
+    uint kind() const { return malicious ? 2 : 1; }
+
+    /**
+     * @brief Strategy of every node, as stored in a checkpoint
+     * 
+     * @return VI strategies, -1 for the nodes with no strategy
      */
-    uint game_dynamics();
+    VI strategies() const;
 
     /**
      * @brief Prints the current strategy profile
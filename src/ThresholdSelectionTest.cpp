@@ -0,0 +1,63 @@
+/**
+ * @file ThresholdSelectionTest.cpp
+ * @author Jaya García
+ * @brief Checks that the threshold game dynamics end without a budget
+ * @version 0.1
+ * @date 2026-01-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+# include "ThresholdSelection.hh"
+# include <random>
+
+int failures = 0;
+
+void check(bool ok, string what) {
+    if (ok) return;
+    cout << "FAILED: " << what << endl;
+    ++failures;
+}
+
+// Small random games under every Jacobi rule. The rounds are not
+// limited, and the time limit is far beyond what they need, so running
+// out of it means the dynamics would not end
+void jacobi_rules_end(uint num_games) {
+    mt19937 gen(3);
+    for (uint g = 0; g < num_games; ++g) {
+        uint n = 25;
+        VE edges;
+        for (uint v = 0; v < n; ++v)
+            for (uint u = 0; u < n; ++u)
+                if (u != v and gen() % 6 == 0)
+                    edges.push_back(edge(v, u, 1));
+        if (edges.empty()) continue;
+        Graph G(edges, VD(), VD(), true, 1);
+        for (ConflictRule rule: {SINGLE_MOVER, INDEPENDENT_SET, SPECULATIVE}) {
+            for (bool malicious: {false, true}) {
+                for (string mode: {"empty", "complete"}) {
+                    Philox initial(g, 0, 0, 0, PICK_INITIAL);
+                    Philox targets(g, 0, 0, 0, PICK_TARGETS);
+                    ThresholdSelection TS(G, malicious);
+                    TS.generator = Philox(g, 0, 0, 0, PICK_SUBSETS);
+                    TS.dynamics = JACOBI;
+                    TS.conflict_rule = rule;
+                    TS.max_seconds = 30;
+                    TS.select_initial_set(0.2, initial);
+                    TS.select_target_set(0.3, targets);
+                    TS.select_initial_configuration(mode);
+                    DynamicsOutcome outcome = TS.game_dynamics();
+                    string game = "game " + to_string(g) + " rule " + to_string(rule) + (malicious ? " malicious " : " cooperative ") + mode;
+                    check(outcome.termination != BUDGET, game);
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    jacobi_rules_end(50);
+    if (failures > 0) return 1;
+    cout << "ThresholdSelection: OK" << endl;
+}